@@ -3,6 +3,7 @@
 ////////////////////////////////////////////////////
 #include <Arduino.h>
 
+#include "TaskScheduler.h"
 #include "BeepController.h"
 
 // =================================================
@@ -20,14 +21,20 @@ CBeepController::CBeepController(int _pinOut, int _pinGnd)
 	m_beepOutPin = _pinOut;
 	m_beepGndPin = _pinGnd;
 
-	setState(beepIdle);
+	m_scheduler = 0;
+	m_task = CTaskScheduler_NO_TASK;
+
+	m_state = beepIdle;
 }
 
 // =================================================
 // Prepare to start beeping
 // =================================================
-void CBeepController::setup()
+void CBeepController::setup(CTaskScheduler &_scheduler)
 {
+	m_scheduler = &_scheduler;
+	m_task = m_scheduler->addTask(beepTask, this);
+
 	// Set my output pin modes
 	pinMode(m_beepOutPin, OUTPUT);
 	digitalWrite(m_beepOutPin, LOW);
@@ -49,11 +56,36 @@ void CBeepController::setup()
 void CBeepController::setState(beepStateE _state)
 {
 	m_state = _state;
-	tick();
+
+	switch(m_state)
+	{
+	default:
+	case beepIdle:
+		m_scheduler->cancel(m_task);
+		break;
+
+	case beepStart:
+		tone(m_beepOutPin, m_freq, m_onTime);	// Start the tone
+		setState(beepOn);
+		break;
+
+	case beepOn:
+		m_scheduler->schedule(m_task, m_onTime);	// Come back when the on time is up
+		break;
+
+	case beepOff:
+		m_scheduler->schedule(m_task, m_offTime);	// And when the off time is up
+		break;
+	}
+}
+
+void CBeepController::beepTask(void *_context)
+{
+	((CBeepController *)_context)->tick();
 }
 
 // =================================================
-// Tick beep cycle
+// Tick beep cycle. Called when the on or off time is up.
 // =================================================
 void CBeepController::tick()
 {
@@ -61,39 +93,23 @@ void CBeepController::tick()
 	{
 	default:
 	case beepIdle:
-		break;
-
 	case beepStart:
-		tone(m_beepOutPin, m_freq, m_onTime);	// Start the tone
-		m_beginningTime = millis();
-		setState(beepOn);
 		break;
 
 	case beepOn:
-		/* Following line relies on overflow behavior of unsigned long,
-		*  and requires that m_onTime not be negative. */
-		if(millis() - m_beginningTime >= m_onTime)	// Time expired?
-		{
-			/*^^^is noTone() below redundant with 3rd arg to tone() above? */
-			noTone(m_beepOutPin);				// Stop the tone
-			m_beginningTime = millis();
-			setState(beepOff);					// Go to off-time state
-		}
+		/*^^^is noTone() below redundant with 3rd arg to tone() above? */
+		noTone(m_beepOutPin);				// Stop the tone
+		setState(beepOff);					// Go to off-time state
 		break;
 
 	case beepOff:
-		/* Following line relies on overflow behavior of unsigned long,
-		*  and requires that m_offTime not be negative. */
-		if(millis() - m_beginningTime >= m_offTime)	// Off time expired?
-		{
-			if(!m_alarm && (m_repeats > 0))	// Decrement the repeat counter?
-				--m_repeats;					// Not if there is an alarm
-
-			if(m_repeats > 0)					// Repeat the on-off cycle?
-				setState(beepStart);			// Start the cycle again
-			else
-				setState(beepIdle);			// All done repeating, so go to idle
-		}
+		if(!m_alarm && (m_repeats > 0))	// Decrement the repeat counter?
+			--m_repeats;					// Not if there is an alarm
+
+		if(m_repeats > 0)					// Repeat the on-off cycle?
+			setState(beepStart);			// Start the cycle again
+		else
+			setState(beepIdle);			// All done repeating, so go to idle
 		break;
 	}
 }
@@ -106,6 +122,9 @@ void CBeepController::beep(int _freq, unsigned long _onTime, unsigned long _offT
 	// Hold alarm state regardless of other requests
 	if(m_alarm) return;
 
+	// Can't time it before setup()
+	if(!m_scheduler) return;
+
 	// Validate the value
 	if(_freq < 32) return;
 	if(_repeats < 1) return;
@@ -22,7 +22,10 @@ public:
 private:
 	beepStateE m_state;
 
-	unsigned long m_beginningTime; // Unit is 1 millisecond. (millis())
+	// On and off times are one-shot tasks
+	CTaskScheduler *m_scheduler;
+	int m_task;
+	static void beepTask(void *_context);
 
 	void setState(beepStateE _state);
 
@@ -43,7 +46,7 @@ public:
 		return m_state;
 	}
 
-	void setup();
+	void setup(CTaskScheduler &_scheduler);
 	void tick();
 
 	void beep(int _freq, unsigned long _onTime, unsigned long _offTime, int _repeats);
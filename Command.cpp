@@ -9,6 +9,8 @@
 #include "Telemetry.h"
 #include "TelemetryTags.h"
 #include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
 
 #include "Pins.h"
 #include "SunCalc.h"
@@ -35,6 +37,7 @@ void CCommand::startReception()
 #endif
 	m_term0 = telemetry_tag_invalid;
 	m_term1 = 0.;
+	m_term2 = 0.;
 }
 
 void CCommand::receiveTerm(int _index, const char *_value)
@@ -60,6 +63,10 @@ void CCommand::receiveTerm(int _index, const char *_value)
 		m_term1 = atof(_value);
 		break;
 
+	case 2:
+		m_term2 = atof(_value);
+		break;
+
 	default:
 		break;
 	}
@@ -90,11 +97,20 @@ void CCommand::processCommand(int _tag, double _value)
 		DEBUG_SERIAL.println(_value);
 #endif
 
-		// Only accept valid versions instead of blind assignment
+		// Only accept valid versions instead of blind assignment.
+		// The ack always goes out in the format in use when the
+		// command arrived; the switch waits for it to be sent.
 		if(_value == 1.)
 		{
 			m_version = TELEMETRY_VERSION_01;
 			ackCommand(_tag, _value);
+			g_telemetry.setTransmitFormat(CTelemetry_Format_ASCII);
+		}
+		else if(_value == 2.)
+		{
+			m_version = TELEMETRY_VERSION_02;
+			ackCommand(_tag, _value);
+			g_telemetry.setTransmitFormat(CTelemetry_Format_Binary);
 		}
 	}
 	else
@@ -109,8 +125,10 @@ void CCommand::processCommand(int _tag, double _value)
 			nakCommand(_tag, _value, telemetry_cmd_response_nak_version_not_set);
 		}
 
-		// Only process after we have a valid version
-		if(m_version == TELEMETRY_VERSION_01)
+		// Only process after we have a valid version. Version 2
+		// only changes the telemetry format, not the commands.
+		if((m_version == TELEMETRY_VERSION_01) ||
+				(m_version == TELEMETRY_VERSION_02))
 			processCommand_V1(_tag, _value);
 	}
 }
@@ -283,6 +301,79 @@ void CCommand::processCommand_V1(int _tag, double _value)
 		}
 		break;
 
+	case telemetry_command_setTelemetryPeriod:
+#ifdef DEBUG_COMMAND_PROCESSOR
+		DEBUG_SERIAL.print(F("CCommand - set telemetry period for tag: "));
+		DEBUG_SERIAL.print(_value);
+		DEBUG_SERIAL.print(F(" seconds: "));
+		DEBUG_SERIAL.println(m_term2);
+#endif
+		// Range check both before converting, so a huge or
+		// non-numeric value can't wrap into a valid one. Zero
+		// turns the tag off.
+		if((_value >= 0.) && (_value < CTelemetryScheduler_MAX_TAGS) &&
+				((m_term2 == 0.) ||
+				 ((m_term2 >= ((double)GARY_COOPER_MIN_TELEMETRY_PERIOD_MS / MILLIS_PER_SECOND)) &&
+				  (m_term2 <= ((double)GARY_COOPER_MAX_TELEMETRY_PERIOD_MS / MILLIS_PER_SECOND)))))
+			commandResponse = g_telemetryScheduler.setPeriod((int)_value, (unsigned long)((m_term2 * MILLIS_PER_SECOND) + 0.5));
+		else
+			commandResponse = telemetry_cmd_response_nak_invalid_value;
+
+		if(commandResponse == telemetry_cmd_response_ack)
+		{
+			ackCommand(_tag, _value);
+		}
+		else
+		{
+			nakCommand(_tag, _value, commandResponse);
+		}
+		break;
+
+	case telemetry_command_setTelemetryBurst:
+#ifdef DEBUG_COMMAND_PROCESSOR
+		DEBUG_SERIAL.print(F("CCommand - set telemetry burst: "));
+		DEBUG_SERIAL.println(_value);
+#endif
+		// Range check before converting, so a huge or
+		// non-numeric value can't wrap into a valid one
+		if(!(_value != _value) &&
+				(_value >= GARY_COOPER_MIN_TELEMETRY_BURST) && (_value <= GARY_COOPER_MAX_TELEMETRY_BURST))
+			commandResponse = g_telemetryScheduler.setBurstSize((int)_value);
+		else
+			commandResponse = telemetry_cmd_response_nak_invalid_value;
+
+		if(commandResponse == telemetry_cmd_response_ack)
+		{
+			ackCommand(_tag, _value);
+		}
+		else
+		{
+			nakCommand(_tag, _value, commandResponse);
+		}
+		break;
+
+	case telemetry_command_setKeyframePeriod:
+#ifdef DEBUG_COMMAND_PROCESSOR
+		DEBUG_SERIAL.print(F("CCommand - set keyframe period: "));
+		DEBUG_SERIAL.println(_value);
+#endif
+		// Range check before converting, so a huge or
+		// non-numeric value can't wrap into a valid one
+		if((_value >= 0.) && (_value <= (GARY_COOPER_MAX_KEYFRAME_PERIOD_MS / MILLIS_PER_SECOND)))
+			commandResponse = setKeyframePeriod((unsigned long)(_value * MILLIS_PER_SECOND));
+		else
+			commandResponse = telemetry_cmd_response_nak_invalid_value;
+
+		if(commandResponse == telemetry_cmd_response_ack)
+		{
+			ackCommand(_tag, _value);
+		}
+		else
+		{
+			nakCommand(_tag, _value, commandResponse);
+		}
+		break;
+
 	case telemetry_command_loadDefaults:
 #ifdef DEBUG_COMMAND_PROCESSOR
 		DEBUG_SERIAL.println(F("CCommand - *** RESET ALL SETTINGS ***"));
@@ -312,7 +403,7 @@ void CCommand::ackCommand(int _tag, double _value)
 	DEBUG_SERIAL.print(F("  Value: "));
 	DEBUG_SERIAL.println(_value);
 #endif
-	g_telemetry.transmissionStart();
+	g_telemetry.transmissionStart(CTelemetry_Priority_Urgent);
 	g_telemetry.sendTerm(telemetry_tag_command_ack);
 	g_telemetry.sendTerm((int)_tag);
 	g_telemetry.sendTerm((double)_value);
@@ -329,7 +420,7 @@ void CCommand::nakCommand(int _tag, double _value, telemetrycommandResponseE _re
 	DEBUG_SERIAL.print(F("  Reason: "));
 	DEBUG_SERIAL.println(_reason);
 #endif
-	g_telemetry.transmissionStart();
+	g_telemetry.transmissionStart(CTelemetry_Priority_Urgent);
 	g_telemetry.sendTerm(telemetry_tag_command_nak);
 	g_telemetry.sendTerm((int)_tag);
 	g_telemetry.sendTerm((double)_value);
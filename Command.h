@@ -9,6 +9,7 @@ protected:
 
 	int m_term0;
 	double m_term1;
+	double m_term2;
 
 	void processCommand(int _tag, double _value);
 
@@ -10,6 +10,8 @@
 #include "TelemetryTags.h"
 #include "Telemetry.h"
 #include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
 
 #include "Pins.h"
 #include "SunCalc.h"
@@ -18,6 +20,8 @@
 #include "BeepController.h"
 #include "GaryCooper.h"
 
+#include "LoopProfiler.h"
+
 ////////////////////////////////////////////////////////////
 // Use GPS to decide when to open and close the coop door
 ////////////////////////////////////////////////////////////
@@ -30,16 +34,28 @@ CDoorController::CDoorController()
 	m_sunsetOffset = 0.;
 
 	m_stuckDoorS = GARY_COOPER_DEF_DOOR_DELAY;
+
+	m_reportedState = doorState_unknown;
 }
 
 CDoorController::~CDoorController()
 {
 }
 
-void CDoorController::setup()
+void CDoorController::setup(CTaskScheduler &_scheduler)
 {
 	if(getDoorMotor())
-		getDoorMotor()->setup();
+		getDoorMotor()->setup(_scheduler);
+
+	// Switches have to be polled, but not every pass
+	_scheduler.schedule(_scheduler.addTask(tickTask, this), 0, CDoorController_TICK_MS);
+}
+
+void CDoorController::tickTask(void *_context)
+{
+	LOOP_PROFILE_BEGIN(loopProfile_door);
+	((CDoorController *)_context)->tick();
+	LOOP_PROFILE_END(loopProfile_door);
 }
 
 void CDoorController::saveSettings(CSaveController &_saveController, bool _defaults)
@@ -86,8 +102,21 @@ void CDoorController::loadSettings(CSaveController &_saveController)
 void CDoorController::tick()
 {
 	// Tick the door motor
-	if(getDoorMotor())
-		getDoorMotor()->tick();
+	if(!getDoorMotor())
+		return;
+
+	getDoorMotor()->tick();
+
+	// This uses the switch reading the motor just took, so
+	// the switches aren't debounced again this tick
+	doorStateE state = getDoorMotor()->getDoorState();
+
+	// Don't make the house wait to hear the door moved
+	if(state != m_reportedState)
+	{
+		m_reportedState = state;
+		sendInfoTelemetry(CTelemetry_Priority_Urgent);
+	}
 
 	// OK, there is a race condition here. If the door is commanded
 	// to a different state, reaches that state, and then is
@@ -100,15 +129,13 @@ void CDoorController::tick()
 	{
 		bool raiseAlarm = false;
 		// Check for failure to open
-		if((m_command == doorCommand_open) &&
-				(getDoorMotor()->getDoorState() != doorState_open))
+		if((m_command == doorCommand_open) && (state != doorState_open))
 		{
 			raiseAlarm = true;
 		}
 
 		// Check for failure to close
-		if((m_command == doorCommand_close) &&
-				(getDoorMotor()->getDoorState() != doorState_closed))
+		if((m_command == doorCommand_close) && (state != doorState_closed))
 		{
 			raiseAlarm = true;
 		}
@@ -249,21 +276,23 @@ void CDoorController::checkTime()
 #endif
 }
 
-void CDoorController::sendTelemetry()
+void CDoorController::sendConfigTelemetry()
 {
-	double doorOpenTime = getDoorOpenTime();
-	double doorCloseTime = getDoorCloseTime();
-
-	// Update telemetry starting with config info
 	g_telemetry.transmissionStart();
 	g_telemetry.sendTerm(telemetry_tag_door_config);
 	g_telemetry.sendTerm((int)getSunriseOffset());
 	g_telemetry.sendTerm((int)getSunsetOffset());
 	g_telemetry.sendTerm((int)getStuckDoorDelay());
 	g_telemetry.transmissionEnd();
+}
 
-	// Now, current times and door state
-	g_telemetry.transmissionStart();
+void CDoorController::sendInfoTelemetry(CTelemetry_PriorityE _priority)
+{
+	double doorOpenTime = getDoorOpenTime();
+	double doorCloseTime = getDoorCloseTime();
+
+	// Current times and door state
+	g_telemetry.transmissionStart(_priority);
 	g_telemetry.sendTerm(telemetry_tag_door_info);
 	g_telemetry.sendTerm(doorOpenTime);
 	g_telemetry.sendTerm(doorCloseTime);
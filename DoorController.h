@@ -13,7 +13,7 @@ class IDoorMotor
 {
 public:
 
-	virtual void setup() = 0;
+	virtual void setup(CTaskScheduler &_scheduler) = 0;
 
 	virtual telemetrycommandResponseE command(doorCommandE _command) = 0;
 	virtual doorStateE getDoorState() = 0;
@@ -22,6 +22,9 @@ public:
 };
 extern IDoorMotor *getDoorMotor();
 
+// How often the door switches and timers are checked
+#define CDoorController_TICK_MS	(50)
+
 // The actual door controller. It is simple and smart.
 class CDoorController
 {
@@ -35,11 +38,16 @@ protected:
 	int m_stuckDoorS;
 	CMilliTimer m_stuckDoorTimer;
 
+	// Last door state reported, to send changes right away
+	doorStateE m_reportedState;
+
+	static void tickTask(void *_context);
+
 public:
 	CDoorController();
 	virtual ~CDoorController();
 
-	void setup();
+	void setup(CTaskScheduler &_scheduler);
 
 	int getStuckDoorDelay()
 	{
@@ -98,7 +106,9 @@ public:
 	void tick();
 
 	void checkTime();
-	void sendTelemetry();
+
+	void sendConfigTelemetry();
+	void sendInfoTelemetry(CTelemetry_PriorityE _priority = CTelemetry_Priority_Bulk);
 
 	telemetrycommandResponseE command(doorCommandE _command);
 };
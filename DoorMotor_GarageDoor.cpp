@@ -10,6 +10,8 @@
 #include "TelemetryTags.h"
 #include "Telemetry.h"
 #include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
 
 #include "Pins.h"
 #include "SunCalc.h"
@@ -19,6 +21,7 @@
 #include "GaryCooper.h"
 
 #include "DoorMotor_GarageDoor.h"
+#include "InputCapture.h"
 
 typedef enum
 {
@@ -42,9 +45,14 @@ IDoorMotor *getDoorMotor()
 
 CDoorMotor_GarageDoor::CDoorMotor_GarageDoor()
 {
+	m_scheduler = 0;
+	m_relayTask = CTaskScheduler_NO_TASK;
+	m_relayOn = false;
+
 	m_seekingKnownState = true;
 	m_state = doorState_unknown;
 	m_lastCommand = (doorCommandE) - 1;
+	m_switches = 0;
 }
 
 CDoorMotor_GarageDoor::~CDoorMotor_GarageDoor()
@@ -52,8 +60,11 @@ CDoorMotor_GarageDoor::~CDoorMotor_GarageDoor()
 
 }
 
-void CDoorMotor_GarageDoor::setup()
+void CDoorMotor_GarageDoor::setup(CTaskScheduler &_scheduler)
 {
+	m_scheduler = &_scheduler;
+	m_relayTask = m_scheduler->addTask(relayOffTask, this);
+
 	// Setup the door relay
 	pinMode(PIN_DOOR_RELAY, OUTPUT);
 	digitalWrite(PIN_DOOR_RELAY, RELAY_OFF);
@@ -106,9 +117,7 @@ telemetrycommandResponseE CDoorMotor_GarageDoor::command(doorCommandE _command)
 		// Remember my last valid command
 		m_lastCommand = _command;
 
-		// Start the relay on timer
-		m_relayTimer.start(CDoorMotor_GarageDoor_relayMS);
-		digitalWrite(PIN_DOOR_RELAY, RELAY_ON);
+		pulseRelay();
 
 		// Set door state to moving and start the stuck timer
 		m_state = doorState_moving;
@@ -136,8 +145,26 @@ doorStateE CDoorMotor_GarageDoor::getDoorState()
 	return m_state;
 }
 
+// Click the relay. relayOffTask() lets go of it.
+void CDoorMotor_GarageDoor::pulseRelay()
+{
+	digitalWrite(PIN_DOOR_RELAY, RELAY_ON);
+	m_relayOn = true;
+	m_scheduler->schedule(m_relayTask, CDoorMotor_GarageDoor_relayMS);
+}
+
+void CDoorMotor_GarageDoor::relayOffTask(void *_context)
+{
+	CDoorMotor_GarageDoor *doorMotor = (CDoorMotor_GarageDoor *)_context;
+
+	digitalWrite(PIN_DOOR_RELAY, RELAY_OFF);
+	doorMotor->m_relayOn = false;
+}
+
 void CDoorMotor_GarageDoor::tick()
 {
+	m_switches = getSwitches();
+
 	// Don't do anything if the switches are in an ugly state
 	if(uglySwitches())
 	{
@@ -145,19 +172,10 @@ void CDoorMotor_GarageDoor::tick()
 		return;
 	}
 
-	// Monitor the relay and turn it off
-	// when the timer hits zero
-	// First "running" test returns to keep the door switch debounce
-	// logic from messing with the relay timing
-	if(m_relayTimer.getState() == CMilliTimer::running)
+	// Leave the switches alone while the relay is clicked
+	if(m_relayOn)
 		return;
 
-	if(m_relayTimer.getState() == CMilliTimer::expired)
-	{
-		m_relayTimer.reset();
-		digitalWrite(PIN_DOOR_RELAY, RELAY_OFF);
-	}
-
 	///////////////////////////////////////////////////////////////////////
 	// If I have not checked my initial state then do it now.
 	if(m_seekingKnownState)
@@ -165,15 +183,13 @@ void CDoorMotor_GarageDoor::tick()
 		// I just started. This is my first tick. If I don't know
 		// where the door is then toggle the relay to get it to
 		// go somewhere!
-		if((getSwitches() == 0) && (m_seekKnownStateRelayCommandIssued == false))
+		if((m_switches == 0) && (m_seekKnownStateRelayCommandIssued == false))
 		{
 
 #ifdef DEBUG_DOOR_MOTOR
 			DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - Started in unknown state, seeking a switch."));
 #endif
-			// Start the relay on timer
-			m_relayTimer.start( CDoorMotor_GarageDoor_relayMS);
-			digitalWrite(PIN_DOOR_RELAY, RELAY_ON);
+			pulseRelay();
 
 			// And a delay to see if we ever get there
 			m_state = doorState_unknown;
@@ -183,7 +199,7 @@ void CDoorMotor_GarageDoor::tick()
 		}
 
 		// I'm waiting for a known state - good or bad.
-		if(getSwitches() == doorSwitchOpen)
+		if(m_switches == doorSwitchOpen)
 		{
 #ifdef DEBUG_DOOR_MOTOR
 			DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - found open-switch, now in known state."));
@@ -192,7 +208,7 @@ void CDoorMotor_GarageDoor::tick()
 			m_seekingKnownState = false;
 			m_stuckDoorTimer.reset();
 		}
-		else if(getSwitches() == doorSwitchClosed)
+		else if(m_switches == doorSwitchClosed)
 		{
 #ifdef DEBUG_DOOR_MOTOR
 			DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - found closed-switch, now in known state."));
@@ -220,7 +236,7 @@ void CDoorMotor_GarageDoor::tick()
 	switch(m_state)
 	{
 	case doorState_moving:
-		if((m_lastCommand == doorCommand_open) && (getSwitches() == doorSwitchOpen))
+		if((m_lastCommand == doorCommand_open) && (m_switches == doorSwitchOpen))
 		{
 #ifdef DEBUG_DOOR_MOTOR
 			DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - reached command state: open"));
@@ -228,7 +244,7 @@ void CDoorMotor_GarageDoor::tick()
 			m_state = doorState_open;
 			m_stuckDoorTimer.reset();
 		}
-		else if((m_lastCommand == doorCommand_close) && (getSwitches() == doorSwitchClosed))
+		else if((m_lastCommand == doorCommand_close) && (m_switches == doorSwitchClosed))
 		{
 #ifdef DEBUG_DOOR_MOTOR
 			DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - reached command state: closed"));
@@ -248,7 +264,7 @@ void CDoorMotor_GarageDoor::tick()
 
 	case doorState_open:
 		// Closed from the open state
-		if((m_state == doorState_open) && (getSwitches() == doorSwitchClosed))
+		if((m_state == doorState_open) && (m_switches == doorSwitchClosed))
 		{
 #ifdef DEBUG_DOOR_MOTOR
 			DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - spontaneous change to: closed"));
@@ -259,7 +275,7 @@ void CDoorMotor_GarageDoor::tick()
 
 	case doorState_closed:
 		// Open from the closed state
-		if((m_state == doorState_closed) && (getSwitches() == doorSwitchOpen))
+		if((m_state == doorState_closed) && (m_switches == doorSwitchOpen))
 		{
 #ifdef DEBUG_DOOR_MOTOR
 			DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - spontaneous change to: open"));
@@ -269,10 +285,10 @@ void CDoorMotor_GarageDoor::tick()
 		break;
 
 	case doorState_unknown:
-		if(getSwitches() == doorSwitchOpen)
+		if(m_switches == doorSwitchOpen)
 			m_state = doorState_open;
 
-		if(getSwitches() == doorSwitchClosed)
+		if(m_switches == doorSwitchClosed)
 			m_state = doorState_closed;
 		break;
 
@@ -287,7 +303,7 @@ void CDoorMotor_GarageDoor::tick()
 	// We are not moving, so we should be in the open or closed state.
 	// Now we monitor for spontaneous changes in the door switches
 	// Loss of door switches
-	if(getSwitches() == 0)
+	if(m_switches == 0)
 	{
 		// The switches went to 0. Someone might be out there
 		// opening the door, so wait until we know for sure.
@@ -350,12 +366,13 @@ unsigned int CDoorMotor_GarageDoor::getSwitches()
 	}
 	while(mask1 != mask2);
 
+	INPUT_CAPTURE_SWITCHES(mask2);
 	return mask2;
 }
 
 bool CDoorMotor_GarageDoor::uglySwitches()
 {
-	if((getSwitches() & doorSwitchOpen) && (getSwitches() & doorSwitchClosed))
+	if((m_switches & doorSwitchOpen) && (m_switches & doorSwitchClosed))
 	{
 #ifdef DEBUG_DOOR_MOTOR
 		DEBUG_SERIAL.println(F("CDoorMotor_GarageDoor - *** Ugly switches ***"));
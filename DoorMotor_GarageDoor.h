@@ -18,7 +18,14 @@
 class CDoorMotor_GarageDoor : public IDoorMotor
 {
 protected:
-	CMilliTimer m_relayTimer;			// Relay on timer
+	// The relay is let go by its own one-shot task, so the
+	// pulse is as long as asked for, not rounded up to a tick
+	CTaskScheduler *m_scheduler;
+	int m_relayTask;
+	bool m_relayOn;
+	static void relayOffTask(void *_context);
+	void pulseRelay();
+
 	CMilliTimer m_stuckDoorTimer;		// How long to wait for a door switch to close
 	CMilliTimer m_lostSwitchesTimer;	// How long have the switches been gone?
 
@@ -35,6 +42,10 @@ protected:
 	doorStateE m_state;
 	doorCommandE m_lastCommand;
 
+	// Debouncing takes a few milliseconds of delay(), so the
+	// switches are read once a tick and the reading is used
+	// until the next one
+	unsigned int m_switches;
 	unsigned int getSwitches();
 	bool uglySwitches();
 
@@ -42,7 +53,7 @@ public:
 	CDoorMotor_GarageDoor();
 	virtual ~CDoorMotor_GarageDoor();
 
-	virtual void setup();
+	virtual void setup(CTaskScheduler &_scheduler);
 
 	virtual telemetrycommandResponseE command(doorCommandE _command);
 	virtual doorStateE getDoorState();
@@ -0,0 +1,243 @@
+////////////////////////////////////////////////////////////
+// GPS Clock
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "ICommInterface.h"
+#include "TelemetryTags.h"
+#include "Telemetry.h"
+#include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
+
+#include "Pins.h"
+#include "SunCalc.h"
+#include "DoorController.h"
+#include "LightController.h"
+#include "BeepController.h"
+#include "GaryCooper.h"
+
+#include "GPSClock.h"
+
+CGPSClock g_GPSClock;
+
+CGPSClock::CGPSClock()
+{
+	m_set = false;
+	m_fixMS = 0;
+	m_fixDay = 0;
+	m_fixMSOfDay = 0;
+
+	m_refMS = 0;
+	m_refDay = 0;
+	m_refMSOfDay = 0;
+
+	m_lastGPSDayOfMonth = -1;
+	m_lastGPSMSOfDay = 0;
+
+	m_haveDrift = false;
+	m_driftPPM = 0.;
+	m_lastErrorMS = 0;
+	m_resets = 0;
+}
+
+CGPSClock::~CGPSClock()
+{
+}
+
+void CGPSClock::update(CGPSParserData &_gpsData)
+{
+	if(!_gpsData.m_GPSLocked)
+		return;
+
+	if(!GPS_IS_VALID_DATA(_gpsData.m_date.m_year) ||
+			!GPS_IS_VALID_DATA(_gpsData.m_date.m_month) ||
+			!GPS_IS_VALID_DATA(_gpsData.m_date.m_day) ||
+			!GPS_IS_VALID_DATA(_gpsData.m_time.m_hour) ||
+			!GPS_IS_VALID_DATA(_gpsData.m_time.m_minute) ||
+			!GPS_IS_VALID_DATA(_gpsData.m_time.m_second))
+		return;
+
+	unsigned long msOfDay = ((_gpsData.m_time.m_hour * 60UL) + _gpsData.m_time.m_minute) * 60000UL +
+							(unsigned long)((_gpsData.m_time.m_second * 1000.) + 0.5);
+
+	// Only new fixes; this is called for every bit of GPS data
+	if((_gpsData.m_date.m_day == m_lastGPSDayOfMonth) && (msOfDay == m_lastGPSMSOfDay))
+		return;
+
+	m_lastGPSDayOfMonth = _gpsData.m_date.m_day;
+	m_lastGPSMSOfDay = msOfDay;
+
+	set(dateToDay(_gpsData.m_date.m_year, _gpsData.m_date.m_month, _gpsData.m_date.m_day), msOfDay);
+}
+
+void CGPSClock::set(long _day, unsigned long _msOfDay)
+{
+	uint32_t now = millis();
+
+	if(isValid())
+	{
+		long ourDay;
+		unsigned long ourMSOfDay;
+		getTimeAt(now, ourDay, ourMSOfDay);
+
+		// More than a day out (a week rollover, a bad fix) is
+		// too far to be in milliseconds in a 32 bit long
+		bool reset = true;
+		if(labs(_day - ourDay) <= 1)
+		{
+			long errorMS = ((_day - ourDay) * (long)CGPSClock_MS_PER_DAY) + (long)(_msOfDay - ourMSOfDay);
+
+			// GGA has no date, so just after midnight it can pair the
+			// new time with yesterday's date. RMC will be along.
+			if(labs(errorMS + (long)CGPSClock_MS_PER_DAY) <= CGPSClock_MAX_ERROR_MS)
+				return;
+
+			if(labs(errorMS) <= CGPSClock_MAX_ERROR_MS)
+			{
+				m_lastErrorMS = errorMS;
+				measureDrift(now, _day, _msOfDay);
+				reset = false;
+			}
+		}
+
+		if(reset)
+		{
+			// Trust the GPS and start measuring again
+			m_resets++;
+			m_lastErrorMS = 0;
+			m_refMS = now;
+			m_refDay = _day;
+			m_refMSOfDay = _msOfDay;
+		}
+	}
+	else
+	{
+		m_lastErrorMS = 0;
+		m_refMS = now;
+		m_refDay = _day;
+		m_refMSOfDay = _msOfDay;
+	}
+
+	m_fixMS = now;
+	m_fixDay = _day;
+	m_fixMSOfDay = _msOfDay;
+	m_set = true;
+}
+
+// Compares GPS time and millis() since the start of the window
+void CGPSClock::measureDrift(uint32_t _now, long _day, unsigned long _msOfDay)
+{
+	unsigned long ourElapsed = _now - m_refMS;
+	if(ourElapsed < CGPSClock_DRIFT_WINDOW_MS)
+		return;
+
+	// Same limit as set(), so the multiply can't overflow
+	long days = _day - m_refDay;
+	if(labs(days) > 1)
+	{
+		m_refMS = _now;
+		m_refDay = _day;
+		m_refMSOfDay = _msOfDay;
+		return;
+	}
+
+	long gpsElapsed = (days * (long)CGPSClock_MS_PER_DAY) + (long)(_msOfDay - m_refMSOfDay);
+	double ppm = ((double)(gpsElapsed - (long)ourElapsed) * 1000000.) / ourElapsed;
+
+	if(fabs(ppm) <= CGPSClock_MAX_DRIFT_PPM)
+	{
+		if(m_haveDrift)
+			m_driftPPM += (ppm - m_driftPPM) / CGPSClock_DRIFT_SMOOTHING;
+		else
+			m_driftPPM = ppm;
+		m_haveDrift = true;
+	}
+
+	m_refMS = _now;
+	m_refDay = _day;
+	m_refMSOfDay = _msOfDay;
+}
+
+void CGPSClock::getTimeAt(uint32_t _ms, long &_day, unsigned long &_msOfDay)
+{
+	// Unsigned, so millis() rolling over doesn't matter
+	unsigned long elapsed = _ms - m_fixMS;
+	elapsed += (long)(elapsed * (m_driftPPM / 1000000.));
+
+	unsigned long msOfDay = m_fixMSOfDay + elapsed;
+	_day = m_fixDay + (long)(msOfDay / CGPSClock_MS_PER_DAY);
+	_msOfDay = msOfDay % CGPSClock_MS_PER_DAY;
+}
+
+bool CGPSClock::isValid()
+{
+	if(m_set && (getMSSinceFix() > CGPSClock_HOLDOVER_MS))
+		m_set = false;
+
+	return m_set;
+}
+
+bool CGPSClock::getUTC(int &_year, int &_month, int &_day, double &_hours)
+{
+	if(!isValid())
+		return false;
+
+	long day;
+	unsigned long msOfDay;
+	getTimeAt(millis(), day, msOfDay);
+
+	dayToDate(day, _year, _month, _day);
+	_hours = msOfDay / 3600000.;
+	return true;
+}
+
+void CGPSClock::sendTelemetry()
+{
+	const char *emptyS = "";
+
+	g_telemetry.transmissionStart();
+	g_telemetry.sendTerm(telemetry_tag_clock);
+	g_telemetry.sendTerm(isValid());
+	if(m_set)
+		g_telemetry.sendTerm(getMSSinceFix() / 1000UL);
+	else
+		g_telemetry.sendTerm(emptyS);
+	g_telemetry.sendTerm(m_driftPPM, 1);
+	g_telemetry.sendTerm(m_lastErrorMS);
+	g_telemetry.sendTerm(m_resets);
+	g_telemetry.transmissionEnd();
+}
+
+////////////////////////////////////////////////////////////
+// Days since 2000-01-01, Gregorian. Counting years from
+// March puts the leap day at the end of the year.
+////////////////////////////////////////////////////////////
+long CGPSClock::dateToDay(int _year, int _month, int _day)
+{
+	long year = _year - ((_month <= 2) ? 1 : 0);
+	long era = ((year >= 0) ? year : (year - 399)) / 400;
+	long yearOfEra = year - (era * 400);
+	long dayOfYear = ((153L * (_month + ((_month > 2) ? -3 : 9))) + 2) / 5 + _day - 1;
+	long dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+
+	// 730425 is 2000-01-01 counted from 0000-03-01
+	return (era * 146097L) + dayOfEra - 730425L;
+}
+
+void CGPSClock::dayToDate(long _dayNumber, int &_year, int &_month, int &_day)
+{
+	long days = _dayNumber + 730425L;
+	long era = ((days >= 0) ? days : (days - 146096L)) / 146097L;
+	long dayOfEra = days - (era * 146097L);
+	long yearOfEra = (dayOfEra - (dayOfEra / 1460) + (dayOfEra / 36524) - (dayOfEra / 146096)) / 365;
+	long dayOfYear = dayOfEra - ((365 * yearOfEra) + (yearOfEra / 4) - (yearOfEra / 100));
+	long monthIndex = ((5 * dayOfYear) + 2) / 153;
+
+	_day = dayOfYear - (((153 * monthIndex) + 2) / 5) + 1;
+	_month = monthIndex + ((monthIndex < 10) ? 3 : -9);
+	_year = yearOfEra + (era * 400) + ((_month <= 2) ? 1 : 0);
+}
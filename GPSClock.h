@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////
+// GPS Clock
+////////////////////////////////////////////////////////////
+#ifndef GPSClock_h
+#define GPSClock_h
+
+////////////////////////////////////////////////////////////
+// UTC that can be read at any time, not just when a fix
+// comes in. Each new locked fix sets the clock; in between,
+// and while the lock is lost, it runs from millis().
+//
+// millis() runs a little fast or slow (the resonator), so
+// the rate is measured against GPS over
+// CGPSClock_DRIFT_WINDOW_MS and corrected for. The error
+// found at each fix is kept for telemetry; a large one
+// (the receiver jumped, or was restarted) resets the clock
+// and the rate measurement.
+//
+// Time since the last fix is an unsigned difference of
+// millis() values, so it is right across the 49.7 day
+// rollover. Without a fix for CGPSClock_HOLDOVER_MS the
+// clock is no longer trusted, long before that difference
+// could wrap.
+//
+// Dates are kept as days since 2000-01-01 and times as
+// milliseconds since midnight. Include after GaryCooper.h.
+////////////////////////////////////////////////////////////
+#define CGPSClock_MS_PER_DAY			(86400000UL)
+#define CGPSClock_HOLDOVER_MS			(7UL * CGPSClock_MS_PER_DAY)
+#define CGPSClock_DRIFT_WINDOW_MS		(10UL * 60UL * 1000UL)
+#define CGPSClock_DRIFT_SMOOTHING		(4)			// Each window moves the estimate 1/4 of the way
+#define CGPSClock_MAX_DRIFT_PPM			(10000.)	// Past this, the measurement is bad
+#define CGPSClock_MAX_ERROR_MS			(2000L)		// Past this, start over
+
+class CGPSClock
+{
+protected:
+	// The last fix, and when it was set
+	bool m_set;
+	uint32_t m_fixMS;
+	long m_fixDay;
+	unsigned long m_fixMSOfDay;
+
+	// Start of the drift measurement
+	uint32_t m_refMS;
+	long m_refDay;
+	unsigned long m_refMSOfDay;
+
+	// Last GPS time seen, to spot new fixes
+	int m_lastGPSDayOfMonth;
+	unsigned long m_lastGPSMSOfDay;
+
+	bool m_haveDrift;
+	double m_driftPPM;			// Positive when millis() is slow
+	long m_lastErrorMS;			// GPS less ours, at the last fix
+	unsigned int m_resets;
+
+	void set(long _day, unsigned long _msOfDay);
+	void getTimeAt(uint32_t _ms, long &_day, unsigned long &_msOfDay);
+	void measureDrift(uint32_t _now, long _day, unsigned long _msOfDay);
+
+public:
+	CGPSClock();
+	virtual ~CGPSClock();
+
+	// After the GPS parser has been fed
+	void update(CGPSParserData &_gpsData);
+
+	bool isValid();
+
+	// False if the clock isn't valid
+	bool getUTC(int &_year, int &_month, int &_day, double &_hours);
+
+	unsigned long getMSSinceFix()
+	{
+		return millis() - m_fixMS;
+	}
+
+	void sendTelemetry();
+
+	static long dateToDay(int _year, int _month, int _day);
+	static void dayToDate(long _dayNumber, int &_year, int &_month, int &_day);
+};
+
+extern CGPSClock g_GPSClock;
+
+#endif
@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////
+// GPS receiver configuration
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "ICommInterface.h"
+#include "TelemetryTags.h"
+#include "Telemetry.h"
+#include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
+
+#include "Pins.h"
+#include "SunCalc.h"
+#include "DoorController.h"
+#include "LightController.h"
+#include "BeepController.h"
+#include "GaryCooper.h"
+
+#include "GPSConfig.h"
+
+#ifdef GARY_COOPER_GPS_CONFIG
+
+// PMTK001 ack flags
+#define CGPSConfig_ACK_SUCCEEDED	(3)
+
+CGPSConfig g_GPSConfig;
+
+CGPSConfig::CGPSConfig()
+{
+	m_scheduler = 0;
+	m_task = CTaskScheduler_NO_TASK;
+	m_comm = 0;
+	m_setBaud = 0;
+
+	m_state = gpsConfig_starting;
+	m_awaitedCommand = -1;
+	m_ackFlag = -1;
+	m_tries = 0;
+
+	m_locked = false;
+	m_wantLocked = false;
+	m_pendingLocked = false;
+	m_baud = GPS_BAUD_RATE;
+
+	m_lineLen = 0;
+
+	m_commandsSent = 0;
+	m_failures = 0;
+}
+
+CGPSConfig::~CGPSConfig()
+{
+}
+
+void CGPSConfig::setup(CTaskScheduler &_scheduler, ICommunicationInterface *_comm, CGPSConfig_SetBaudFunction _setBaud)
+{
+	m_scheduler = &_scheduler;
+	m_comm = _comm;
+	m_setBaud = _setBaud;
+
+	m_task = _scheduler.addTask(tickTask, this);
+	wake(CGPSConfig_START_DELAY_MS);
+}
+
+void CGPSConfig::tickTask(void *_context)
+{
+	((CGPSConfig *)_context)->tick();
+}
+
+void CGPSConfig::wake(unsigned long _delayMS)
+{
+	m_scheduler->schedule(m_task, _delayMS);
+}
+
+void CGPSConfig::setLocked(bool _locked)
+{
+	m_wantLocked = _locked;
+
+	if((m_state == gpsConfig_ready) && (m_locked != m_wantLocked))
+		wake(0);
+}
+
+void CGPSConfig::sendCommand(int _command, const char *_args)
+{
+	char sentence[64];
+	unsigned int len = 0;
+
+	sentence[len++] = '$';
+	memcpy(sentence + len, "PMTK", 4);
+	len += 4;
+	sentence[len++] = '0' + ((_command / 100) % 10);
+	sentence[len++] = '0' + ((_command / 10) % 10);
+	sentence[len++] = '0' + (_command % 10);
+
+	unsigned int argsLen = strlen(_args);
+	memcpy(sentence + len, _args, argsLen);
+	len += argsLen;
+
+	// The '$' is not part of the checksum
+	unsigned char checksum = 0;
+	for(unsigned int index = 1; index < len; ++index)
+		checksum ^= sentence[index];
+
+	sentence[len++] = '*';
+	sentence[len++] = g_telemetryHexChars[(checksum & 0xF0) >> 4];
+	sentence[len++] = g_telemetryHexChars[checksum & 0x0F];
+	sentence[len++] = '\r';
+	sentence[len++] = '\n';
+
+	m_comm->write((const unsigned char *)sentence, len);
+
+	m_awaitedCommand = _command;
+	m_ackFlag = -1;
+	m_commandsSent++;
+}
+
+void CGPSConfig::sendOutput(unsigned char _divisor)
+{
+	// GLL, RMC, VTG, GGA, GSA, GSV, then the rarer ones
+	char args[] = ",0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0";
+	args[3] = '0' + _divisor;
+	args[7] = '0' + _divisor;
+
+	sendCommand(314, args);
+}
+
+void CGPSConfig::sendBaud(unsigned long _baud)
+{
+	char args[12];
+	args[0] = ',';
+	args[1 + Telemetry_UtoA(_baud, args + 1)] = '\0';
+
+	sendCommand(251, args);
+}
+
+// Sends the command for the state we are in again
+void CGPSConfig::resend()
+{
+	switch(m_state)
+	{
+	case gpsConfig_setOutput:
+		sendOutput(1);
+		break;
+
+	case gpsConfig_testBaud:
+		sendCommand(0, "");
+		break;
+
+	case gpsConfig_setRate:
+		sendOutput(m_pendingLocked ? CGPSConfig_LOCKED_DIVISOR : 1);
+		break;
+
+	default:
+		break;
+	}
+}
+
+bool CGPSConfig::acked()
+{
+	return m_ackFlag == CGPSConfig_ACK_SUCCEEDED;
+}
+
+void CGPSConfig::tick()
+{
+	switch(m_state)
+	{
+	case gpsConfig_starting:
+		sendOutput(1);
+		m_state = gpsConfig_setOutput;
+		m_tries = 1;
+		wake(CGPSConfig_ACK_TIMEOUT_MS);
+		break;
+
+	case gpsConfig_setOutput:
+		if(acked())
+		{
+#ifdef GPS_FAST_BAUD_RATE
+			sendBaud(GPS_FAST_BAUD_RATE);
+			m_state = gpsConfig_setBaud;
+			wake(CGPSConfig_DRAIN_MS);
+#else
+			m_state = gpsConfig_ready;
+			wake(0);
+#endif
+		}
+		else if(m_tries < CGPSConfig_TRIES)
+		{
+			resend();
+			m_tries++;
+			wake(CGPSConfig_ACK_TIMEOUT_MS);
+		}
+		else
+		{
+			// Not a PMTK receiver, leave it alone
+			m_failures++;
+			m_state = gpsConfig_failed;
+		}
+		break;
+
+#ifdef GPS_FAST_BAUD_RATE
+	case gpsConfig_setBaud:
+	case gpsConfig_revertBaud:
+		// PMTK251 isn't acked. Switch once it has gone out;
+		// closing the port waits for the UART to empty.
+		if(m_comm->bytesInTransmitBuffer())
+		{
+			wake(CGPSConfig_DRAIN_MS);
+			break;
+		}
+
+		if(m_state == gpsConfig_revertBaud)
+		{
+			m_baud = GPS_BAUD_RATE;
+			m_setBaud(m_baud);
+			m_state = gpsConfig_ready;
+			wake(0);
+			break;
+		}
+
+		m_baud = GPS_FAST_BAUD_RATE;
+		m_setBaud(m_baud);
+		sendCommand(0, "");
+		m_state = gpsConfig_testBaud;
+		m_tries = 1;
+		wake(CGPSConfig_ACK_TIMEOUT_MS);
+		break;
+
+	case gpsConfig_testBaud:
+		if(acked())
+		{
+			m_state = gpsConfig_ready;
+			wake(0);
+		}
+		else if(m_tries < CGPSConfig_TRIES)
+		{
+			resend();
+			m_tries++;
+			wake(CGPSConfig_ACK_TIMEOUT_MS);
+		}
+		else
+		{
+			// In case it did switch, tell it to go back
+			m_failures++;
+			sendBaud(GPS_BAUD_RATE);
+			m_state = gpsConfig_revertBaud;
+			wake(CGPSConfig_DRAIN_MS);
+		}
+		break;
+#endif
+
+	case gpsConfig_ready:
+		if(m_locked != m_wantLocked)
+		{
+			m_pendingLocked = m_wantLocked;
+			sendOutput(m_pendingLocked ? CGPSConfig_LOCKED_DIVISOR : 1);
+			m_state = gpsConfig_setRate;
+			m_tries = 1;
+			wake(CGPSConfig_ACK_TIMEOUT_MS);
+		}
+		break;
+
+	case gpsConfig_setRate:
+		if(acked() || (m_tries >= CGPSConfig_TRIES))
+		{
+			// Don't keep at it if it won't take
+			if(!acked())
+				m_failures++;
+
+			m_locked = m_pendingLocked;
+			m_state = gpsConfig_ready;
+			wake(0);
+		}
+		else
+		{
+			resend();
+			m_tries++;
+			wake(CGPSConfig_ACK_TIMEOUT_MS);
+		}
+		break;
+
+	case gpsConfig_failed:
+	default:
+		break;
+	}
+}
+
+void CGPSConfig::receive(const unsigned char *_buf, unsigned int _bufLen)
+{
+	for(unsigned int index = 0; index < _bufLen; ++index)
+	{
+		char c = _buf[index];
+
+		if(c == '$')
+			m_lineLen = 0;
+
+		if((c == '\r') || (c == '\n'))
+		{
+			if(m_lineLen && (m_lineLen < sizeof(m_line)))
+			{
+				m_line[m_lineLen] = '\0';
+				parseLine();
+			}
+			m_lineLen = 0;
+			continue;
+		}
+
+		// Too long to be an ack, ignore the rest of it
+		if(m_lineLen < (sizeof(m_line) - 1))
+			m_line[m_lineLen++] = c;
+		else
+			m_lineLen = sizeof(m_line);
+	}
+}
+
+// $PMTK001,<command>,<flag>*<checksum>
+void CGPSConfig::parseLine()
+{
+	if(strncmp(m_line, "$PMTK001,", 9))
+		return;
+
+	char *star = strchr(m_line, '*');
+	if(!star || (strlen(star) != 3))
+		return;
+
+	unsigned char checksum = 0;
+	for(char *c = m_line + 1; c < star; ++c)
+		checksum ^= *c;
+	if((star[1] != g_telemetryHexChars[(checksum & 0xF0) >> 4]) || (star[2] != g_telemetryHexChars[checksum & 0x0F]))
+		return;
+
+	char *flag = strchr(m_line + 9, ',');
+	if(!flag || (flag > star))
+		return;
+
+	if(atoi(m_line + 9) != m_awaitedCommand)
+		return;
+
+	m_ackFlag = atoi(flag + 1);
+
+	// Don't wait out the timeout
+	if(m_scheduler && (m_state != gpsConfig_ready) && (m_state != gpsConfig_failed))
+		wake(0);
+}
+
+void CGPSConfig::sendTelemetry()
+{
+	g_telemetry.transmissionStart();
+	g_telemetry.sendTerm(telemetry_tag_gps_config);
+	g_telemetry.sendTerm((int)m_state);
+	g_telemetry.sendTerm(m_baud);
+	g_telemetry.sendTerm(m_locked);
+	g_telemetry.sendTerm(m_commandsSent);
+	g_telemetry.sendTerm(m_failures);
+	g_telemetry.transmissionEnd();
+}
+
+#endif // GARY_COOPER_GPS_CONFIG
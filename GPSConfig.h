@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////
+// GPS receiver configuration
+////////////////////////////////////////////////////////////
+#ifndef GPSConfig_h
+#define GPSConfig_h
+
+////////////////////////////////////////////////////////////
+// Left alone, a receiver sends every sentence it knows once
+// a second, and we only look at the time once a minute.
+// This sets up a MediaTek (PMTK) receiver at startup:
+//
+// - Only RMC and GGA are sent (PMTK314).
+// - Once locked, they are only sent every
+//   CGPSConfig_LOCKED_DIVISOR fixes, and every fix again
+//   while there is no lock, so it is found quickly.
+// - If GPS_FAST_BAUD_RATE is defined (Pins.h), the port is
+//   switched to it (PMTK251). The receiver has to answer a
+//   test command (PMTK000) at the new rate, or both ends go
+//   back to GPS_BAUD_RATE.
+//
+// Each command is sent until the receiver acks it
+// ($PMTK001,<command>,3), CGPSConfig_TRIES times at most.
+// If the first one is never acked, the receiver doesn't
+// speak PMTK and it is left as it is. Acks arrive from
+// CNMEAFilter, which hands over the $P sentences.
+//
+// Define GARY_COOPER_GPS_CONFIG in GaryCooper.h to turn it
+// on. Include after GaryCooper.h.
+////////////////////////////////////////////////////////////
+#ifdef GARY_COOPER_GPS_CONFIG
+
+#define CGPSConfig_START_DELAY_MS	(1000)	// Receiver boot
+#define CGPSConfig_ACK_TIMEOUT_MS	(1000)
+#define CGPSConfig_DRAIN_MS			(10)	// Polling for a sent command
+#define CGPSConfig_TRIES			(3)
+#define CGPSConfig_LOCKED_DIVISOR	(5)		// 1 - 5 fixes per sentence
+#define CGPSConfig_LINE_LEN			(24)	// Longest $P sentence we read
+
+// Reopens the GPS port at a new baud rate
+typedef void (*CGPSConfig_SetBaudFunction)(unsigned long _baud);
+
+typedef enum
+{
+	gpsConfig_starting = 0,
+	gpsConfig_setOutput,		// Only RMC and GGA
+	gpsConfig_setBaud,			// Waiting for PMTK251 to go out
+	gpsConfig_testBaud,			// PMTK000 at the new rate
+	gpsConfig_revertBaud,		// Waiting for PMTK251 to go out
+	gpsConfig_ready,
+	gpsConfig_setRate,			// Output divisor for the lock state
+	gpsConfig_failed,			// Not a PMTK receiver
+} gpsConfigStateE;
+
+class CGPSConfig : public ICommunicationSink
+{
+protected:
+	CTaskScheduler *m_scheduler;
+	int m_task;
+	ICommunicationInterface *m_comm;
+	CGPSConfig_SetBaudFunction m_setBaud;
+
+	gpsConfigStateE m_state;
+	int m_awaitedCommand;
+	int m_ackFlag;				// -1 until acked
+	unsigned char m_tries;
+
+	bool m_locked;				// What the output rate is set for
+	bool m_wantLocked;
+	bool m_pendingLocked;		// Being set
+	unsigned long m_baud;
+
+	char m_line[CGPSConfig_LINE_LEN];
+	unsigned char m_lineLen;
+
+	unsigned int m_commandsSent;
+	unsigned int m_failures;
+
+	static void tickTask(void *_context);
+	void tick();
+	void wake(unsigned long _delayMS);
+
+	void sendCommand(int _command, const char *_args);
+	void sendOutput(unsigned char _divisor);
+	void sendBaud(unsigned long _baud);
+	void resend();
+	bool acked();
+
+	void parseLine();
+
+public:
+	CGPSConfig();
+	virtual ~CGPSConfig();
+
+	void setup(CTaskScheduler &_scheduler, ICommunicationInterface *_comm, CGPSConfig_SetBaudFunction _setBaud);
+
+	// From the time check, once a minute
+	void setLocked(bool _locked);
+
+	// $P sentences from the NMEA filter
+	void receive(const unsigned char *_buf, unsigned int _bufLen);
+
+	gpsConfigStateE getState()
+	{
+		return m_state;
+	}
+
+	void sendTelemetry();
+};
+
+extern CGPSConfig g_GPSConfig;
+
+#define GPS_CONFIG_LOCKED(_locked)		g_GPSConfig.setLocked(_locked)
+
+#else
+
+#define GPS_CONFIG_LOCKED(_locked)
+
+#endif // GARY_COOPER_GPS_CONFIG
+
+#endif
@@ -19,6 +19,22 @@
 //#define DEBUG_COMMAND_PROCESSOR_INTERFACE
 #define DEBUG_SETTINGS
 
+// Time the sections of loop() and send the stats
+// as telemetry? Costs RAM and a little time.
+//#define GARY_COOPER_LOOP_PROFILER
+
+// Log everything that comes in (GPS, telemetry, door
+// switches) to CAPTURE_SERIAL, for replay on a PC?
+//#define GARY_COOPER_INPUT_CAPTURE
+
+// Tell a MediaTek (PMTK) GPS to send only what we use,
+// and less often once it has a lock?
+//#define GARY_COOPER_GPS_CONFIG
+
+// Sleep when there is nothing to do? Saves power
+// on solar coops.
+#define GARY_COOPER_IDLE_SLEEP
+
 // Beep on door change?
 #define COOPDOOR_CHANGE_BEEPER
 
@@ -33,6 +49,8 @@ extern void saveSettings(bool _defaults = false);
 
 // Important globals
 extern CTelemetry g_telemetry;
+extern CTelemetryScheduler g_telemetryScheduler;
+extern CTaskScheduler g_taskScheduler;
 extern CDoorController g_doorController;
 extern CLightController g_lightController;
 extern CBeepController g_beepController;
@@ -43,5 +61,8 @@ extern CSaveController g_saveController;
 void debugPrintDoubleTime(double _t, bool _newline = true);
 
 void reportError(telemetryErrorE _errorTag, bool _set);
-void sendErrors();
+void sendErrors(CTelemetry_PriorityE _priority = CTelemetry_Priority_Bulk);
+void sendTelemetryTag(int _tag);
+telemetrycommandResponseE setKeyframePeriod(unsigned long _periodMS);
+void receiveGPSData(unsigned char *_data, unsigned int _dataLen);
 #endif
@@ -11,9 +11,13 @@
 #include "Telemetry.h"
 #include "TelemetryTags.h"
 #include "SlidingBuf.h"
+#include "SPSCQueue.h"
+#include "SerialPort.h"
 #include "Comm_Arduino.h"
 #include "Command.h"
 #include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
 
 #include "Pins.h"
 #include "SunCalc.h"
@@ -22,10 +26,35 @@
 #include "BeepController.h"
 #include "GaryCooper.h"
 
-// GPS parser
+#include "LoopProfiler.h"
+#include "IdleSleep.h"
+#include "InputCapture.h"
+#include "NMEAFilter.h"
+#include "GPSConfig.h"
+#include "GPSClock.h"
+
+// GPS parser, and what it gets to see
 CGPSParser g_GPSParser;
+static CNMEAFilter s_NMEAFilter(g_GPSParser);
 static bool s_gpsDataStreamActive = false;
 
+// GPS port. Little is ever sent to the GPS, so its
+// transmit buffers are small.
+#define GPS_TRANSMIT_BUFSIZE			(64)
+#define GPS_URGENT_TRANSMIT_BUFSIZE		(16)
+#define GPS_RECEIVE_BUFSIZE				(64)
+typedef CSerialPort<GPS_SERIAL, GPS_TRANSMIT_BUFSIZE, GPS_URGENT_TRANSMIT_BUFSIZE, GPS_RECEIVE_BUFSIZE> CGPSPort;
+static CGPSPort s_GPSPort;
+#ifdef GARY_COOPER_GPS_CONFIG
+static CComm_Arduino<CGPSPort> s_GPSComm(s_GPSPort);
+
+static void setGPSBaud(unsigned long _baud)
+{
+	s_GPSPort.close();
+	s_GPSPort.open(_baud);
+}
+#endif
+
 // Door controller
 CDoorController g_doorController;
 
@@ -45,16 +74,48 @@ CSunCalc g_sunCalc;
 // Telemetry module
 CTelemetry g_telemetry;
 static CCommand s_commandProcessor;
-static CComm_Arduino g_telemetryComm;
+typedef CSerialPort<TELEMETRY_SERIAL> CTelemetryPort;
+static CTelemetryPort s_telemetryPort;
+static CComm_Arduino<CTelemetryPort> g_telemetryComm(s_telemetryPort);
+#ifdef GARY_COOPER_INPUT_CAPTURE
+static CInputCaptureSink s_telemetryCaptureSink(inputCapture_telemetry, &g_telemetry);
+#endif
+
+// Timer 0 runs millis() and has a spare compare interrupt, which
+// fires once a millisecond. It keeps the GPS and telemetry UARTs
+// drained so a slow loop() (EEPROM writes, switch debouncing)
+// doesn't overrun their 64 byte buffers.
+ISR(TIMER0_COMPA_vect)
+{
+	s_GPSPort.pollReceive();
+	s_telemetryPort.pollReceive();
+}
+
+// Everything that runs on a timer
+CTaskScheduler g_taskScheduler;
+void heartbeatTask(void *_context);
+void keyframeTask(void *_context);
+void telemetrySchedulerTask(void *_context);
+void timeCheckTask(void *_context);
 
 // Various behavioral delays
 #define TIME_CHECK_UPDATE_NO_GPS_LOCK	(5 * MILLIS_PER_SECOND)
 #define TIME_CHECK_UPDATE_GPS_LOCK		(60 * MILLIS_PER_SECOND)
-CMilliTimer g_timeCheckTimer;
+static int s_timeCheckTask = CTaskScheduler_NO_TASK;
+
+// Telemetry is sent by tag, each at its own rate. Tag
+// periods are at least this, so it is checked this often.
+CTelemetryScheduler g_telemetryScheduler;
+#define TELEMETRY_SCHEDULER_UPDATE	(GARY_COOPER_MIN_TELEMETRY_PERIOD_MS)
 
-// Frequency of telemetry transmission
+// Heartbeat
 #define TELEMETRY_UPDATE	(2 * MILLIS_PER_SECOND)
-CMilliTimer g_telemetryUpdateTimer;
+
+// Only changed telemetry is sent each update. Everything
+// is sent this often so the house recovers from lost data.
+// The house can change it with telemetry_command_setKeyframePeriod.
+#define TELEMETRY_KEYFRAME_UPDATE	(GARY_COOPER_DEF_KEYFRAME_PERIOD_MS)
+static int s_keyframeTask = CTaskScheduler_NO_TASK;
 
 // Flashing the LED
 bool g_heartbeat = false;
@@ -132,54 +193,102 @@ void setup()
 
 	// Prep debug port
 	DEBUG_SERIAL.begin(DEBUG_BAUD_RATE);
+	INPUT_CAPTURE_OPEN();
 
 	// Prep the GPS port
-	GPS_SERIAL.begin(GPS_BAUD_RATE);
+	s_GPSPort.open(GPS_BAUD_RATE);
+#ifdef GARY_COOPER_GPS_CONFIG
+	s_NMEAFilter.setProprietarySink(&g_GPSConfig);
+	g_GPSConfig.setup(g_taskScheduler, &s_GPSComm, setGPSBaud);
+#endif
 
 	// Prep the telemetry port
-	g_telemetryComm.open(TELEMETRY_PORT, TELEMETRY_BAUD_RATE);
+	s_telemetryPort.open(TELEMETRY_BAUD_RATE);
 	g_telemetry.setInterfaces(&g_telemetryComm, &s_commandProcessor);
+#ifdef GARY_COOPER_INPUT_CAPTURE
+	g_telemetryComm.setReceiveSink(&s_telemetryCaptureSink);
+#endif
+
+	// Start polling the UARTs from the timer 0 interrupt
+	OCR0A = 0x80;
+	TIMSK0 |= _BV(OCIE0A);
+	g_telemetry.setDeltaMode(true);
 
 	// Setup the door controller
-	g_doorController.setup();
+	g_doorController.setup(g_taskScheduler);
 
 	// And the light controller
 	g_lightController.setup();
 
 	// Beep to indicate starting the main loop
-	g_beepController.setup();
+	g_beepController.setup(g_taskScheduler);
 	g_beepController.beep(BEEP_FREQ_INFO, 50, 50, 2);
 
-	// Telemetry updates every two seconds
-	g_telemetryUpdateTimer.start(TELEMETRY_UPDATE);
+	// Telemetry tag rates. Errors and door state need to be fresh,
+	// position and configuration don't. Phases spread them out.
+	//									tag							period						phase	priority
+	g_telemetryScheduler.setSendFunction(sendTelemetryTag);
+	g_telemetryScheduler.addTag(telemetry_tag_error_flags,	500,						0,		0);
+	g_telemetryScheduler.addTag(telemetry_tag_door_info,	500,						250,	0);
+	g_telemetryScheduler.addTag(telemetry_tag_light_info,	2 * MILLIS_PER_SECOND,		500,	1);
+	g_telemetryScheduler.addTag(telemetry_tag_version,		10 * MILLIS_PER_SECOND,		1000,	2);
+	g_telemetryScheduler.addTag(telemetry_tag_date_time,	10 * MILLIS_PER_SECOND,		1500,	2);
+	g_telemetryScheduler.addTag(telemetry_tag_sun_times,	60 * MILLIS_PER_SECOND,		2000,	3);
+	g_telemetryScheduler.addTag(telemetry_tag_GPSStatus,	60 * MILLIS_PER_SECOND,		2500,	3);
+	g_telemetryScheduler.addTag(telemetry_tag_door_config,	60 * MILLIS_PER_SECOND,		3000,	3);
+	g_telemetryScheduler.addTag(telemetry_tag_light_config,	60 * MILLIS_PER_SECOND,		3500,	3);
+	g_telemetryScheduler.addTag(telemetry_tag_link_stats,	60 * MILLIS_PER_SECOND,		4000,	3);
+	g_telemetryScheduler.addTag(telemetry_tag_nmea_stats,	60 * MILLIS_PER_SECOND,		5500,	3);
+	g_telemetryScheduler.addTag(telemetry_tag_clock,		60 * MILLIS_PER_SECOND,		6500,	3);
+	g_telemetryScheduler.addTag(telemetry_tag_sun_cache,	60 * MILLIS_PER_SECOND,		7000,	3);
+#ifdef GARY_COOPER_GPS_CONFIG
+	g_telemetryScheduler.addTag(telemetry_tag_gps_config,	60 * MILLIS_PER_SECOND,		6000,	3);
+#endif
+#ifdef GARY_COOPER_LOOP_PROFILER
+	// One section per sentence, so each is sent once a minute
+	g_telemetryScheduler.addTag(telemetry_tag_loop_profile,	(60 * MILLIS_PER_SECOND) / loopProfile_count,	4500,	3);
+#endif
+#ifdef GARY_COOPER_IDLE_SLEEP
+	g_telemetryScheduler.addTag(telemetry_tag_duty_cycle,	60 * MILLIS_PER_SECOND,		5000,	3);
+#endif
 
-	// Prep the update timer. This delay
-	// allows the GPS to get some data before we start
-	// processing more slowly
-	g_timeCheckTimer.start(TIME_CHECK_UPDATE_NO_GPS_LOCK);
+	// Timed work
+	g_taskScheduler.schedule(g_taskScheduler.addTask(heartbeatTask, 0), TELEMETRY_UPDATE, TELEMETRY_UPDATE);
+	s_keyframeTask = g_taskScheduler.addTask(keyframeTask, 0);
+	g_taskScheduler.schedule(s_keyframeTask, TELEMETRY_KEYFRAME_UPDATE, TELEMETRY_KEYFRAME_UPDATE);
+	g_taskScheduler.schedule(g_taskScheduler.addTask(telemetrySchedulerTask, 0), 0, TELEMETRY_SCHEDULER_UPDATE);
+
+	// This delay allows the GPS to get some data before
+	// we start processing more slowly
+	s_timeCheckTask = g_taskScheduler.addTask(timeCheckTask, 0);
+	g_taskScheduler.schedule(s_timeCheckTask, TIME_CHECK_UPDATE_NO_GPS_LOCK);
+
+	// Replay lines up its timers with ours from here
+	INPUT_CAPTURE(inputCapture_setup, 0, 0);
 }
 
 void loop()
 {
+	LOOP_PROFILE_BEGIN(loopProfile_loop);
+
 	// Load settings?
 	if(!settingsLoaded)
 	{
 		loadSettings();
 		settingsLoaded = true;
+		INPUT_CAPTURE_SETTINGS();
 	}
 
 	// Process all available GPS data
-	while(GPS_SERIAL.available())
+	LOOP_PROFILE_BEGIN(loopProfile_GPS);
+	s_GPSPort.tick();
+	while(s_GPSPort.bytesInReceiveBuffer())
 	{
-		unsigned char GPSData[256];
+		unsigned char GPSData[GPS_RECEIVE_BUFSIZE + 1];
 		unsigned int GPSDataLen = 0;
 
 		// Get the data from the serial port
-		GPSDataLen = GPS_SERIAL.available();
-		if(GPSDataLen > sizeof(GPSData) - 1)
-			GPSDataLen = sizeof(GPSData) - 1;
-
-		GPSDataLen = GPS_SERIAL.readBytes((unsigned char *)GPSData, GPSDataLen);
+		GPSDataLen = s_GPSPort.read(GPSData, sizeof(GPSData) - 1);
 		if(GPSDataLen)
 		{
 #ifdef DEBUG_RAW_GPS
@@ -187,81 +296,119 @@ void loop()
 			String rawGPS((const char *)GPSData);
 			DEBUG_SERIAL.print(rawGPS);
 #endif
-			// Parse the GPS data
-			g_GPSParser.parse(GPSData, GPSDataLen);
-
-			// Note that we have received some data
-			// from the GPS serial port.
-			s_gpsDataStreamActive = true;
+			receiveGPSData(GPSData, GPSDataLen);
 		}
 	}
+	LOOP_PROFILE_END(loopProfile_GPS);
 
 	// Let the telemetry module process serial data
-	g_telemetryComm.tick();
+	LOOP_PROFILE_BEGIN(loopProfile_telemetryComm);
+	s_telemetryPort.tick();
 	g_telemetry.tick();
+	LOOP_PROFILE_END(loopProfile_telemetryComm);
+
+	// Run whatever timed work is due
+	LOOP_PROFILE_BEGIN(loopProfile_tasks);
+	g_taskScheduler.tick();
+	LOOP_PROFILE_END(loopProfile_tasks);
+
+	LOOP_PROFILE_END(loopProfile_loop);
+
+#ifdef GARY_COOPER_IDLE_SLEEP
+	// Sleep if there is nothing to do until the next interrupt.
+	// Interrupts are off while we look so nothing can arrive
+	// between deciding and sleeping.
+	noInterrupts();
+	if(!s_GPSPort.wantsTick() && !s_telemetryPort.wantsTick() && g_taskScheduler.timeToNextDeadline())
+		g_idleSleep.sleep();
+	else
+		interrupts();
+#endif
+}
 
-	// Let the beep controller run
-	g_beepController.tick();
+// Parse GPS data. Replay calls this too.
+void receiveGPSData(unsigned char *_data, unsigned int _dataLen)
+{
+	INPUT_CAPTURE(inputCapture_GPS, _data, _dataLen);
 
-	// Let the door controller time its relay
-	g_doorController.tick();
+	s_NMEAFilter.parse(_data, _dataLen);
+	g_GPSClock.update(g_GPSParser.getGPSData());
 
-	// Send telemetry
-	if(g_telemetryUpdateTimer.getState() == CMilliTimer::expired)
-	{
-		// Blink the LED
-		g_heartbeat = !g_heartbeat;
-		digitalWrite(PIN_HEARTBEAT_LED, g_heartbeat);
+	// Note that we have received some data
+	// from the GPS serial port.
+	s_gpsDataStreamActive = true;
+}
 
-		// Reset the timer
-		g_telemetryUpdateTimer.start(TELEMETRY_UPDATE);
+// Blink the LED so we know it's alive
+void heartbeatTask(void *_context)
+{
+	g_heartbeat = !g_heartbeat;
+	digitalWrite(PIN_HEARTBEAT_LED, g_heartbeat);
+}
 
-		// Send telemetry version number
-		g_telemetry.transmissionStart();
-		g_telemetry.sendTerm(telemetry_tag_version);
-		g_telemetry.sendTerm(TELEMETRY_VERSION_01);
-		g_telemetry.transmissionEnd();
+// Time to send everything
+void keyframeTask(void *_context)
+{
+	g_telemetry.requestKeyframe();
+}
 
-		// Send standing errors
-		sendErrors();
+// Zero turns keyframes off, leaving only the changes
+telemetrycommandResponseE setKeyframePeriod(unsigned long _periodMS)
+{
+	if((_periodMS != 0) &&
+			((_periodMS < GARY_COOPER_MIN_KEYFRAME_PERIOD_MS) || (_periodMS > GARY_COOPER_MAX_KEYFRAME_PERIOD_MS)))
+		return telemetry_cmd_response_nak_invalid_value;
 
-		// And the rest of the telemetry
-		g_sunCalc.sendTelemetry();
-		g_doorController.sendTelemetry();
-		g_lightController.sendTelemetry();
-	}
+	if(_periodMS)
+		g_taskScheduler.schedule(s_keyframeTask, _periodMS, _periodMS);
+	else
+		g_taskScheduler.cancel(s_keyframeTask);
 
-	// If the update timer has completed then
-	// read the GPS data and check the time to
-	// see if anything needs to be done
-	if(g_timeCheckTimer.getState() == CMilliTimer::expired)
-	{
-		// Prep for next update
-		if(g_GPSParser.getGPSData().m_GPSLocked)
-			g_timeCheckTimer.start(TIME_CHECK_UPDATE_GPS_LOCK);
-		else
-			g_timeCheckTimer.start(TIME_CHECK_UPDATE_NO_GPS_LOCK);
+	return telemetry_cmd_response_ack;
+}
 
+// Send telemetry that is due
+void telemetrySchedulerTask(void *_context)
+{
+	LOOP_PROFILE_BEGIN(loopProfile_telemetrySend);
+	g_telemetryScheduler.tick();
+	LOOP_PROFILE_END(loopProfile_telemetrySend);
+}
 
-		// If the GPS is not sending any data then report an error
-		if(!s_gpsDataStreamActive)
-		{
-			g_GPSParser.getGPSData().clear();
-			reportError(telemetry_error_GPS_no_data, true);
-		}
-		else
-		{
-			reportError(telemetry_error_GPS_no_data, false);
-		}
+// Check the GPS data and the time to see if
+// anything needs to be done
+void timeCheckTask(void *_context)
+{
+	// Replay has to feed the GPS data we are about to use first
+	INPUT_CAPTURE_FLUSH();
 
-		s_gpsDataStreamActive = false;
+	// Less GPS data while it is locked
+	GPS_CONFIG_LOCKED(g_GPSParser.getGPSData().m_GPSLocked);
 
-		// If we have a valid time fix, control the door and light
-		if(g_sunCalc.processGPSData(g_GPSParser.getGPSData()))
-		{
-			g_doorController.checkTime();
-			g_lightController.checkTime();
-		}
+	// Prep for next update
+	if(g_GPSParser.getGPSData().m_GPSLocked)
+		g_taskScheduler.schedule(s_timeCheckTask, TIME_CHECK_UPDATE_GPS_LOCK);
+	else
+		g_taskScheduler.schedule(s_timeCheckTask, TIME_CHECK_UPDATE_NO_GPS_LOCK);
+
+	// If the GPS is not sending any data then report an error
+	if(!s_gpsDataStreamActive)
+	{
+		g_GPSParser.getGPSData().clear();
+		reportError(telemetry_error_GPS_no_data, true);
+	}
+	else
+	{
+		reportError(telemetry_error_GPS_no_data, false);
+	}
+
+	s_gpsDataStreamActive = false;
+
+	// If we know the time and where we are, control the door and light
+	if(g_sunCalc.processGPSData(g_GPSParser.getGPSData()))
+	{
+		g_doorController.checkTime();
+		g_lightController.checkTime();
 	}
 }
 
@@ -301,6 +448,9 @@ void reportError(telemetryErrorE _errorTag, bool _set)
 		s_errorFlags &= ~_errorTag;
 	}
 
+	// Let the house know now, not at the next scheduled send
+	sendErrors(CTelemetry_Priority_Urgent);
+
 	// Report error to console
 	String errorString(_errorTag);
 	switch(_errorTag)
@@ -363,9 +513,100 @@ void reportError(telemetryErrorE _errorTag, bool _set)
 	DEBUG_SERIAL.println();
 }
 
-void sendErrors()
+// Called by the telemetry scheduler when a tag is due
+void sendTelemetryTag(int _tag)
+{
+	switch(_tag)
+	{
+	case telemetry_tag_version:
+		g_telemetry.transmissionStart();
+		g_telemetry.sendTerm(telemetry_tag_version);
+		g_telemetry.sendTerm((g_telemetry.getTransmitFormat() == CTelemetry_Format_Binary) ?
+							 TELEMETRY_VERSION_02 : TELEMETRY_VERSION_01);
+		g_telemetry.transmissionEnd();
+		break;
+
+	case telemetry_tag_error_flags:
+		sendErrors();
+		break;
+
+	case telemetry_tag_GPSStatus:
+		g_sunCalc.sendGPSStatusTelemetry();
+		break;
+
+	case telemetry_tag_date_time:
+		g_sunCalc.sendDateTimeTelemetry();
+		break;
+
+	case telemetry_tag_sun_times:
+		g_sunCalc.sendSunTimesTelemetry();
+		break;
+
+	case telemetry_tag_door_config:
+		g_doorController.sendConfigTelemetry();
+		break;
+
+	case telemetry_tag_door_info:
+		g_doorController.sendInfoTelemetry();
+		break;
+
+	case telemetry_tag_light_config:
+		g_lightController.sendConfigTelemetry();
+		break;
+
+	case telemetry_tag_light_info:
+		g_lightController.sendInfoTelemetry();
+		break;
+
+	case telemetry_tag_link_stats:
+		g_telemetry.transmissionStart();
+		g_telemetry.sendTerm(telemetry_tag_link_stats);
+		g_telemetry.sendTerm(g_telemetry.getDroppedSentences(CTelemetry_Priority_Bulk));
+		g_telemetry.sendTerm(g_telemetry.getDroppedSentences(CTelemetry_Priority_Urgent));
+		g_telemetry.sendTerm(g_telemetry.getEvictedSentences());
+		g_telemetry.sendTerm(s_telemetryPort.getReceiveOverruns());
+		g_telemetry.sendTerm(s_telemetryPort.getUARTFullCount());
+		g_telemetry.transmissionEnd();
+		break;
+
+	case telemetry_tag_nmea_stats:
+		s_NMEAFilter.sendTelemetry();
+		break;
+
+	case telemetry_tag_clock:
+		g_GPSClock.sendTelemetry();
+		break;
+
+	case telemetry_tag_sun_cache:
+		g_sunCalc.sendSunCacheTelemetry();
+		break;
+
+#ifdef GARY_COOPER_GPS_CONFIG
+	case telemetry_tag_gps_config:
+		g_GPSConfig.sendTelemetry();
+		break;
+#endif
+
+#ifdef GARY_COOPER_LOOP_PROFILER
+	case telemetry_tag_loop_profile:
+		g_loopProfiler.sendTelemetry();
+		break;
+#endif
+
+#ifdef GARY_COOPER_IDLE_SLEEP
+	case telemetry_tag_duty_cycle:
+		g_idleSleep.sendTelemetry();
+		break;
+#endif
+
+	default:
+		break;
+	}
+}
+
+void sendErrors(CTelemetry_PriorityE _priority)
 {
-	g_telemetry.transmissionStart();
+	g_telemetry.transmissionStart(_priority);
 	g_telemetry.sendTerm(telemetry_tag_error_flags);
 	g_telemetry.sendTerm(s_errorFlags);
 	g_telemetry.transmissionEnd();
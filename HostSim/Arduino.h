@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////
+// Host simulation - Arduino core shim
+////////////////////////////////////////////////////////////
+#ifndef Arduino_h
+#define Arduino_h
+
+////////////////////////////////////////////////////////////
+// Just enough of the Arduino core for the sketch to build
+// and run on a PC. Time is virtual: it only moves when
+// CHostSim says so (or delay() is called), and the UARTs
+// move bytes at their baud rate in virtual time. See
+// HostSim.h for the controls.
+////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+// Pins
+#define LOW				(0)
+#define HIGH			(1)
+
+#define INPUT			(0)
+#define OUTPUT			(1)
+#define INPUT_PULLUP	(2)
+
+#define LED_BUILTIN		(13)
+#define NUM_DIGITAL_PINS	(70)	// Mega 2560
+
+void pinMode(uint8_t _pin, uint8_t _mode);
+void digitalWrite(uint8_t _pin, uint8_t _value);
+int digitalRead(uint8_t _pin);
+
+void tone(uint8_t _pin, unsigned int _frequency, unsigned long _duration = 0);
+void noTone(uint8_t _pin);
+
+// Time. 32 bits, as on the board, so they roll over at
+// the same place, and sums with them wrap with them.
+uint32_t millis();
+uint32_t micros();
+void delay(unsigned long _ms);
+void delayMicroseconds(unsigned int _us);
+
+// Interrupts. Only the timer 0 compare A interrupt is simulated.
+void noInterrupts();
+void interrupts();
+#define cli()	noInterrupts()
+#define sei()	interrupts()
+
+#define ISR(_vector)	extern "C" void _vector(void)
+
+extern uint8_t OCR0A;
+extern uint8_t TIMSK0;
+#define OCIE0A			(1)
+#define _BV(_bit)		(1 << (_bit))
+
+// Flash strings are ordinary strings here
+class __FlashStringHelper;
+#define F(_string)		(reinterpret_cast<const __FlashStringHelper *>(_string))
+#define PROGMEM
+#define PSTR(_string)	(_string)
+#define pgm_read_byte(_address)	(*(const uint8_t *)(_address))
+#define pgm_read_word(_address)	(*(const uint16_t *)(_address))
+#define strlen_P		strlen
+#define strcpy_P		strcpy
+#define memcpy_P		memcpy
+
+// Math
+#define PI			(3.1415926535897932384626433832795)
+#define HALF_PI		(1.5707963267948966192313216916398)
+#define TWO_PI		(6.283185307179586476925286766559)
+#define DEG_TO_RAD	(0.017453292519943295769236907684886)
+#define RAD_TO_DEG	(57.295779513082320876798154814105)
+
+template <class _A, class _B> inline auto min(const _A &_a, const _B &_b) -> decltype((_a < _b) ? _a : _b)
+{
+	return (_a < _b) ? _a : _b;
+}
+
+template <class _A, class _B> inline auto max(const _A &_a, const _B &_b) -> decltype((_a > _b) ? _a : _b)
+{
+	return (_a > _b) ? _a : _b;
+}
+
+#define constrain(_x, _low, _high)	((_x) < (_low) ? (_low) : ((_x) > (_high) ? (_high) : (_x)))
+
+// Number bases for print()
+#define DEC	(10)
+#define HEX	(16)
+#define OCT	(8)
+#define BIN	(2)
+
+class String
+{
+protected:
+	std::string m_string;
+
+public:
+	String(const char *_string = "") : m_string(_string ? _string : "") {}
+	String(const __FlashStringHelper *_string) : m_string((const char *)_string) {}
+	String(char _c) : m_string(1, _c) {}
+	String(int _value, int _base = DEC);
+	String(unsigned int _value, int _base = DEC);
+	String(long _value, int _base = DEC);
+	String(unsigned long _value, int _base = DEC);
+
+	String &operator=(const char *_string)
+	{
+		m_string = _string ? _string : "";
+		return *this;
+	}
+
+	String &operator=(const __FlashStringHelper *_string)
+	{
+		return operator=((const char *)_string);
+	}
+
+	String &operator+=(const String &_string)
+	{
+		m_string += _string.m_string;
+		return *this;
+	}
+
+	const char *c_str() const
+	{
+		return m_string.c_str();
+	}
+
+	unsigned int length() const
+	{
+		return m_string.length();
+	}
+};
+
+// Serial ports
+#define SERIAL_RX_BUFFER_SIZE	(64)
+#define SERIAL_TX_BUFFER_SIZE	(64)
+
+class HardwareSerial
+{
+protected:
+	unsigned long m_baud;		// Zero when closed
+	unsigned long m_peerBaud;	// Zero for the same as ours
+
+	// Bytes on the wire, not yet received, and the UART's
+	// receive buffer
+	std::string m_wire;
+	std::string m_receiveBuf;
+	unsigned long m_receiveOverruns;
+
+	// The UART's transmit buffer, and what has gone out
+	std::string m_transmitBuf;
+	std::string m_transmitted;
+
+	// Fractions of a byte owed from earlier ticks
+	unsigned long m_receiveBits;
+	unsigned long m_transmitBits;
+
+	size_t printNumber(unsigned long _value, int _base);
+
+public:
+	HardwareSerial();
+
+	void begin(unsigned long _baud);
+	void end();
+
+	int available();
+	int read();
+	int peek();
+	size_t readBytes(uint8_t *_buf, size_t _length);
+	size_t readBytes(char *_buf, size_t _length)
+	{
+		return readBytes((uint8_t *)_buf, _length);
+	}
+
+	int availableForWrite();
+	size_t write(uint8_t _c);
+	size_t write(const uint8_t *_buf, size_t _length);
+	size_t write(const char *_string)
+	{
+		return write((const uint8_t *)_string, strlen(_string));
+	}
+	void flush();
+
+	size_t print(const char *_string);
+	size_t print(const __FlashStringHelper *_string);
+	size_t print(const String &_string);
+	size_t print(char _c);
+	size_t print(int _value, int _base = DEC);
+	size_t print(unsigned int _value, int _base = DEC);
+	size_t print(long _value, int _base = DEC);
+	size_t print(unsigned long _value, int _base = DEC);
+	size_t print(double _value, int _digits = 2);
+
+	size_t println();
+	template <class _T> size_t println(const _T &_value)
+	{
+		size_t n = print(_value);
+		return n + println();
+	}
+	template <class _T> size_t println(const _T &_value, int _format)
+	{
+		size_t n = print(_value, _format);
+		return n + println();
+	}
+
+	// Simulation side
+	void simTick(unsigned long _elapsedUS);
+
+	// Put bytes on the wire. They reach the UART at the baud rate.
+	void simReceive(const void *_data, size_t _length);
+	size_t simBytesOnWire()
+	{
+		return m_wire.length();
+	}
+
+	// Nothing to move, so time can skip ahead
+	bool simIdle()
+	{
+		return !m_baud || (m_wire.empty() && m_transmitBuf.empty());
+	}
+
+	// Zero when closed
+	unsigned long simBaud()
+	{
+		return m_baud;
+	}
+
+	// The device on the other end. While the rates differ,
+	// bytes cross the wire as garbage (top bit set).
+	void simSetPeerBaud(unsigned long _baud)
+	{
+		m_peerBaud = _baud;
+	}
+
+	// Bytes lost because the UART receive buffer was full
+	unsigned long simReceiveOverruns()
+	{
+		return m_receiveOverruns;
+	}
+
+	// Everything sent since the last call
+	std::string simTakeTransmitted();
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
+
+#endif
@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////
+// Host simulation - EEPROM shim
+////////////////////////////////////////////////////////////
+#ifndef EEPROM_h
+#define EEPROM_h
+
+////////////////////////////////////////////////////////////
+// EEPROM in RAM. Blank cells read 0xFF, like a new part.
+// CHostSim can load and save the image so settings last
+// between runs.
+////////////////////////////////////////////////////////////
+#define E2END	(0xFFF)	// Mega 2560, 4K
+
+class EEPROMClass
+{
+protected:
+	uint8_t m_data[E2END + 1];
+
+public:
+	EEPROMClass()
+	{
+		memset(m_data, 0xFF, sizeof(m_data));
+	}
+
+	uint8_t read(int _address)
+	{
+		return m_data[_address];
+	}
+
+	void write(int _address, uint8_t _value)
+	{
+		m_data[_address] = _value;
+	}
+
+	void update(int _address, uint8_t _value)
+	{
+		m_data[_address] = _value;
+	}
+
+	uint8_t &operator[](int _address)
+	{
+		return m_data[_address];
+	}
+
+	template <class _T> _T &get(int _address, _T &_value)
+	{
+		memcpy(&_value, m_data + _address, sizeof(_T));
+		return _value;
+	}
+
+	template <class _T> const _T &put(int _address, const _T &_value)
+	{
+		memcpy(m_data + _address, &_value, sizeof(_T));
+		return _value;
+	}
+
+	uint16_t length()
+	{
+		return E2END + 1;
+	}
+
+	// Simulation side
+	uint8_t *simData()
+	{
+		return m_data;
+	}
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
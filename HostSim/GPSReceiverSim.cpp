@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////
+// Host simulation - a GPS receiver
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <Arduino.h>
+
+#include "HostSim.h"
+#include "GPSReceiverSim.h"
+
+CGPSReceiverSim::CGPSReceiverSim(HardwareSerial &_port, bool _PMTK) :
+	m_port(_port)
+{
+	m_PMTK = _PMTK;
+
+	m_baud = CGPSReceiverSim_DEF_BAUD_RATE;
+	setDefaults();
+	m_nextFixUS = 0;
+	m_fixes = 0;
+
+	// 40N 83W, from 2026-06-01 00:00 UTC
+	m_lat = 40.0;
+	m_lon = -83.0;
+	m_startTime = 1780272000;
+	m_lockMS = CGPSReceiverSim_DEF_LOCK_MS;
+
+	m_port.simSetPeerBaud(m_baud);
+
+	m_commands = 0;
+	m_acks = 0;
+	m_sentences = 0;
+	m_bytesSent = 0;
+	m_garbledBytes = 0;
+}
+
+CGPSReceiverSim::~CGPSReceiverSim()
+{
+}
+
+void CGPSReceiverSim::setDefaults()
+{
+	for(int sentence = 0; sentence < gpsReceiverSim_count; ++sentence)
+		m_divisors[sentence] = 1;
+
+	m_fixIntervalMS = 1000;
+}
+
+void CGPSReceiverSim::deliver(const std::string &_data)
+{
+	m_bytesSent += _data.length();
+	m_port.simReceive(_data.data(), _data.length());
+}
+
+void CGPSReceiverSim::sendSentence(const std::string &_body)
+{
+	unsigned char checksum = 0;
+	for(size_t index = 0; index < _body.length(); ++index)
+		checksum ^= _body[index];
+
+	char tail[8];
+	snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+
+	deliver("$" + _body + tail);
+	m_sentences++;
+}
+
+static std::string formatCoordinate(double _degrees, int _degreeDigits, char _positive, char _negative)
+{
+	double value = fabs(_degrees);
+	int whole = (int)value;
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%0*d%07.4f,%c", _degreeDigits, whole, (value - whole) * 60.0,
+			 (_degrees >= 0) ? _positive : _negative);
+	return buf;
+}
+
+void CGPSReceiverSim::sendFix()
+{
+	unsigned long long elapsedMS = g_hostSim.getElapsedUS() / 1000;
+	bool locked = (elapsedMS >= m_lockMS);
+
+	time_t now = m_startTime + (time_t)(elapsedMS / 1000);
+	struct tm utc;
+	gmtime_r(&now, &utc);
+
+	char time[32], date[32];
+	snprintf(time, sizeof(time), "%02d%02d%02d.000", utc.tm_hour, utc.tm_min, utc.tm_sec);
+	snprintf(date, sizeof(date), "%02d%02d%02d", utc.tm_mday, utc.tm_mon + 1, utc.tm_year % 100);
+
+	std::string lat = locked ? formatCoordinate(m_lat, 2, 'N', 'S') : ",";
+	std::string lon = locked ? formatCoordinate(m_lon, 3, 'E', 'W') : ",";
+
+	// In the order an MTK sends them
+	for(int sentence = 0; sentence < gpsReceiverSim_count; ++sentence)
+	{
+		static const gpsReceiverSimSentenceE order[gpsReceiverSim_count] =
+		{
+			gpsReceiverSim_GGA, gpsReceiverSim_GSA, gpsReceiverSim_GSV,
+			gpsReceiverSim_RMC, gpsReceiverSim_VTG, gpsReceiverSim_GLL
+		};
+		gpsReceiverSimSentenceE type = order[sentence];
+
+		if(!m_divisors[type] || (m_fixes % m_divisors[type]))
+			continue;
+
+		switch(type)
+		{
+		case gpsReceiverSim_GGA:
+			sendSentence(std::string("GPGGA,") + time + "," + lat + "," + lon + "," +
+						 (locked ? "1,08,0.9,245.1,M,-33.9,M,," : "0,00,,,M,,M,,"));
+			break;
+
+		case gpsReceiverSim_GSA:
+			sendSentence(locked ? "GPGSA,A,3,04,05,09,12,17,24,25,28,,,,,1.6,0.9,1.3" : "GPGSA,A,1,,,,,,,,,,,,,,,");
+			break;
+
+		case gpsReceiverSim_GSV:
+			sendSentence("GPGSV,3,1,11,04,40,083,46,05,17,308,41,09,07,344,39,12,22,228,45");
+			sendSentence("GPGSV,3,2,11,17,40,083,46,24,17,308,41,25,07,344,39,28,22,228,45");
+			sendSentence("GPGSV,3,3,11,30,40,083,46,31,17,308,41,32,07,344,39");
+			break;
+
+		case gpsReceiverSim_RMC:
+			sendSentence(std::string("GPRMC,") + time + (locked ? ",A," : ",V,") + lat + "," + lon +
+						 ",0.00,0.00," + date + ",,,");
+			break;
+
+		case gpsReceiverSim_VTG:
+			sendSentence("GPVTG,0.00,T,,M,0.00,N,0.00,K,N");
+			break;
+
+		case gpsReceiverSim_GLL:
+			sendSentence("GPGLL," + lat + "," + lon + "," + time + (locked ? ",A,A" : ",V,N"));
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	m_fixes++;
+}
+
+// $PMTKnnn,...*cs, without the line end
+void CGPSReceiverSim::handleCommand(const std::string &_sentence)
+{
+	size_t star = _sentence.find('*');
+	if((_sentence.compare(0, 5, "$PMTK") != 0) || (star == std::string::npos) || (star + 3 != _sentence.length()))
+		return;
+
+	unsigned char checksum = 0;
+	for(size_t index = 1; index < star; ++index)
+		checksum ^= _sentence[index];
+	if(strtoul(_sentence.c_str() + star + 1, 0, 16) != checksum)
+		return;
+
+	m_commands++;
+
+	int command = atoi(_sentence.c_str() + 5);
+	std::string args = _sentence.substr(8, star - 8);
+	int flag = 3;
+
+	switch(command)
+	{
+	case 0:
+		break;
+
+	case 220:
+	{
+		unsigned long interval = strtoul(args.c_str() + 1, 0, 10);
+		if((interval < 100) || (interval > 10000))
+			flag = 0;
+		else
+			m_fixIntervalMS = interval;
+		break;
+	}
+
+	case 251:
+	{
+		unsigned long baud = strtoul(args.c_str() + 1, 0, 10);
+		m_baud = baud ? baud : CGPSReceiverSim_DEF_BAUD_RATE;
+		m_port.simSetPeerBaud(m_baud);
+		return;
+	}
+
+	case 314:
+		if(!args.compare(0, 3, ",-1"))
+			setDefaults();
+		else
+		{
+			const char *field = args.c_str();
+			for(int sentence = 0; (sentence < gpsReceiverSim_count) && (*field == ','); ++sentence)
+			{
+				m_divisors[sentence] = strtoul(field + 1, (char **)&field, 10);
+				if(m_divisors[sentence] > 5)
+					flag = 0;
+			}
+		}
+		break;
+
+	default:
+		flag = 1;
+		break;
+	}
+
+	char ack[32];
+	snprintf(ack, sizeof(ack), "PMTK001,%d,%d", command, flag);
+	sendSentence(ack);
+	m_acks++;
+}
+
+void CGPSReceiverSim::tick()
+{
+	// Commands from the sketch
+	std::string received = m_port.simTakeTransmitted();
+	if(m_PMTK)
+	{
+		for(size_t index = 0; index < received.length(); ++index)
+		{
+			char c = received[index];
+
+			// Sent at the wrong baud rate
+			if(c & 0x80)
+			{
+				m_garbledBytes++;
+				continue;
+			}
+
+			if(c == '$')
+				m_command.clear();
+
+			if((c == '\r') || (c == '\n'))
+			{
+				if(!m_command.empty())
+					handleCommand(m_command);
+				m_command.clear();
+			}
+			else
+				m_command += c;
+		}
+	}
+
+	while(g_hostSim.getElapsedUS() >= m_nextFixUS)
+	{
+		sendFix();
+		m_nextFixUS += m_fixIntervalMS * 1000ULL;
+	}
+}
+
+void CGPSReceiverSim::printStats(FILE *_file)
+{
+	fprintf(_file, "GPS receiver: %lu baud, %lu fixes, %lu sentences, %lu bytes sent, %lu commands, %lu acked, %lu bytes garbled\n",
+			m_baud, m_fixes, m_sentences, m_bytesSent, m_commands, m_acks, m_garbledBytes);
+}
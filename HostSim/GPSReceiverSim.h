@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////
+// Host simulation - a GPS receiver
+////////////////////////////////////////////////////////////
+#ifndef GPSReceiverSim_h
+#define GPSReceiverSim_h
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+////////////////////////////////////////////////////////////
+// A MediaTek style receiver on the end of a serial port.
+// Out of the box it sends RMC, GGA, GSA, three GSV, VTG and
+// GLL every fix, once a second, at 9600 baud, and gets a
+// lock after a while. It answers the PMTK commands the
+// sketch uses:
+//
+//   PMTK000			Test, acked
+//   PMTK220,<ms>		Fix interval, acked
+//   PMTK251,<baud>		Baud rate, not acked, as on the real thing
+//   PMTK314,<rates>	Fixes per sentence for GLL, RMC, VTG,
+//						GGA, GSA, GSV (-1 for the defaults), acked
+//
+// Anything else is acked as unsupported. A plain NMEA
+// receiver ignores them all. While the two ends disagree on
+// the baud rate, each sees the other's bytes as garbage.
+//
+// Call tick() after every loop pass.
+////////////////////////////////////////////////////////////
+#define CGPSReceiverSim_DEF_BAUD_RATE	(9600)
+#define CGPSReceiverSim_DEF_LOCK_MS		(30000)
+
+// Fixes per sentence, in PMTK314 order
+typedef enum
+{
+	gpsReceiverSim_GLL = 0,
+	gpsReceiverSim_RMC,
+	gpsReceiverSim_VTG,
+	gpsReceiverSim_GGA,
+	gpsReceiverSim_GSA,
+	gpsReceiverSim_GSV,
+
+	gpsReceiverSim_count
+} gpsReceiverSimSentenceE;
+
+class CGPSReceiverSim
+{
+protected:
+	HardwareSerial &m_port;
+	bool m_PMTK;
+
+	unsigned long m_baud;
+	unsigned int m_divisors[gpsReceiverSim_count];
+	unsigned long m_fixIntervalMS;
+	unsigned long long m_nextFixUS;
+	unsigned long m_fixes;
+
+	double m_lat, m_lon;
+	time_t m_startTime;
+	unsigned long m_lockMS;
+
+	std::string m_command;
+
+	// Totals
+	unsigned long m_commands;
+	unsigned long m_acks;
+	unsigned long m_sentences;
+	unsigned long m_bytesSent;
+	unsigned long m_garbledBytes;
+
+	void deliver(const std::string &_data);
+	void sendSentence(const std::string &_body);
+	void sendFix();
+	void handleCommand(const std::string &_sentence);
+	void setDefaults();
+
+public:
+	CGPSReceiverSim(HardwareSerial &_port, bool _PMTK = true);
+	virtual ~CGPSReceiverSim();
+
+	void setPosition(double _lat, double _lon)
+	{
+		m_lat = _lat;
+		m_lon = _lon;
+	}
+
+	void setStartTime(time_t _startTime)
+	{
+		m_startTime = _startTime;
+	}
+
+	void setLockMS(unsigned long _lockMS)
+	{
+		m_lockMS = _lockMS;
+	}
+
+	unsigned long getBaud()
+	{
+		return m_baud;
+	}
+
+	void tick();
+
+	void printStats(FILE *_file);
+};
+
+#endif
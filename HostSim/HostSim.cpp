@@ -0,0 +1,574 @@
+////////////////////////////////////////////////////////////
+// Host simulation
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/sleep.h>
+
+#include "HostSim.h"
+
+// The sketch's timer 0 compare interrupt, if it has one
+extern "C" void TIMER0_COMPA_vect(void) __attribute__((weak));
+
+uint8_t OCR0A = 0;
+uint8_t TIMSK0 = 0;
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+HardwareSerial Serial3;
+
+EEPROMClass EEPROM;
+
+CHostSim g_hostSim;
+
+////////////////////////////////////////////////////////////
+// Arduino core
+////////////////////////////////////////////////////////////
+void pinMode(uint8_t _pin, uint8_t _mode)
+{
+	g_hostSim.pinMode(_pin, _mode);
+}
+
+void digitalWrite(uint8_t _pin, uint8_t _value)
+{
+	g_hostSim.digitalWrite(_pin, _value);
+}
+
+int digitalRead(uint8_t _pin)
+{
+	return g_hostSim.digitalRead(_pin);
+}
+
+void tone(uint8_t _pin, unsigned int _frequency, unsigned long _duration)
+{
+	g_hostSim.tone(_pin, _frequency);
+}
+
+void noTone(uint8_t _pin)
+{
+	g_hostSim.tone(_pin, 0);
+}
+
+uint32_t millis()
+{
+	return g_hostSim.getMillis();
+}
+
+uint32_t micros()
+{
+	return g_hostSim.getMicros();
+}
+
+void delay(unsigned long _ms)
+{
+	g_hostSim.advanceUS(_ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int _us)
+{
+	g_hostSim.advanceUS(_us);
+}
+
+void noInterrupts()
+{
+	g_hostSim.setInterrupts(false);
+}
+
+void interrupts()
+{
+	g_hostSim.setInterrupts(true);
+}
+
+void set_sleep_mode(uint8_t _mode)
+{
+}
+
+void sleep_enable()
+{
+	g_hostSim.setSleepEnabled(true);
+}
+
+void sleep_disable()
+{
+	g_hostSim.setSleepEnabled(false);
+}
+
+void sleep_cpu()
+{
+	g_hostSim.sleep();
+}
+
+////////////////////////////////////////////////////////////
+// String
+////////////////////////////////////////////////////////////
+static const char *formatNumber(unsigned long _value, int _base, bool _negative, char *_buf, int _bufSize)
+{
+	char *c = _buf + _bufSize - 1;
+	*c = '\0';
+
+	if(_base < 2)
+		_base = DEC;
+
+	do
+	{
+		int digit = _value % _base;
+		*--c = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+		_value /= _base;
+	}
+	while(_value);
+
+	if(_negative)
+		*--c = '-';
+
+	return c;
+}
+
+String::String(int _value, int _base)
+{
+	char buf[40];
+	m_string = (_base == DEC) ? formatNumber(labs(_value), DEC, (_value < 0), buf, sizeof(buf)) :
+			   formatNumber((unsigned int)_value, _base, false, buf, sizeof(buf));
+}
+
+String::String(unsigned int _value, int _base)
+{
+	char buf[40];
+	m_string = formatNumber(_value, _base, false, buf, sizeof(buf));
+}
+
+String::String(long _value, int _base)
+{
+	char buf[40];
+	m_string = (_base == DEC) ? formatNumber(labs(_value), DEC, (_value < 0), buf, sizeof(buf)) :
+			   formatNumber((unsigned long)_value, _base, false, buf, sizeof(buf));
+}
+
+String::String(unsigned long _value, int _base)
+{
+	char buf[40];
+	m_string = formatNumber(_value, _base, false, buf, sizeof(buf));
+}
+
+////////////////////////////////////////////////////////////
+// Serial ports
+////////////////////////////////////////////////////////////
+// Start, eight data and stop bits
+#define HardwareSerial_BITS_PER_BYTE	(10ULL)
+
+HardwareSerial::HardwareSerial()
+{
+	m_baud = 0;
+	m_peerBaud = 0;
+	m_receiveOverruns = 0;
+	m_receiveBits = 0;
+	m_transmitBits = 0;
+}
+
+void HardwareSerial::begin(unsigned long _baud)
+{
+	m_baud = _baud;
+	m_receiveBuf.clear();
+	m_transmitBuf.clear();
+}
+
+void HardwareSerial::end()
+{
+	flush();
+	m_baud = 0;
+}
+
+int HardwareSerial::available()
+{
+	return m_receiveBuf.length();
+}
+
+int HardwareSerial::read()
+{
+	if(m_receiveBuf.empty())
+		return -1;
+
+	uint8_t c = m_receiveBuf[0];
+	m_receiveBuf.erase(0, 1);
+	return c;
+}
+
+int HardwareSerial::peek()
+{
+	return m_receiveBuf.empty() ? -1 : (uint8_t)m_receiveBuf[0];
+}
+
+size_t HardwareSerial::readBytes(uint8_t *_buf, size_t _length)
+{
+	size_t count = (_length < m_receiveBuf.length()) ? _length : m_receiveBuf.length();
+	memcpy(_buf, m_receiveBuf.data(), count);
+	m_receiveBuf.erase(0, count);
+	return count;
+}
+
+int HardwareSerial::availableForWrite()
+{
+	return (SERIAL_TX_BUFFER_SIZE - 1) - m_transmitBuf.length();
+}
+
+size_t HardwareSerial::write(uint8_t _c)
+{
+	if(!m_baud)
+		return 0;
+
+	// Like the real thing, wait for room
+	while(m_transmitBuf.length() >= (SERIAL_TX_BUFFER_SIZE - 1))
+		g_hostSim.advanceUS(100);
+
+	m_transmitBuf += (char)_c;
+	return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *_buf, size_t _length)
+{
+	size_t count = 0;
+	while(count < _length)
+	{
+		if(!write(_buf[count]))
+			break;
+		++count;
+	}
+
+	return count;
+}
+
+void HardwareSerial::flush()
+{
+	while(m_baud && !m_transmitBuf.empty())
+		g_hostSim.advanceUS(100);
+}
+
+size_t HardwareSerial::printNumber(unsigned long _value, int _base)
+{
+	// Closed ports drop everything, so don't bother formatting
+	if(!m_baud)
+		return 0;
+
+	char buf[40];
+	return write(formatNumber(_value, _base, false, buf, sizeof(buf)));
+}
+
+size_t HardwareSerial::print(const char *_string)
+{
+	return m_baud ? write(_string) : 0;
+}
+
+size_t HardwareSerial::print(const __FlashStringHelper *_string)
+{
+	return m_baud ? write((const char *)_string) : 0;
+}
+
+size_t HardwareSerial::print(const String &_string)
+{
+	return write(_string.c_str());
+}
+
+size_t HardwareSerial::print(char _c)
+{
+	return write((uint8_t)_c);
+}
+
+size_t HardwareSerial::print(int _value, int _base)
+{
+	return print((long)_value, _base);
+}
+
+size_t HardwareSerial::print(unsigned int _value, int _base)
+{
+	return printNumber(_value, _base);
+}
+
+size_t HardwareSerial::print(long _value, int _base)
+{
+	if((_base == DEC) && (_value < 0))
+		return print('-') + printNumber(-(unsigned long)_value, DEC);
+
+	return printNumber((unsigned long)_value, _base);
+}
+
+size_t HardwareSerial::print(unsigned long _value, int _base)
+{
+	return printNumber(_value, _base);
+}
+
+size_t HardwareSerial::print(double _value, int _digits)
+{
+	if(!m_baud)
+		return 0;
+
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.*f", _digits, _value);
+	return write(buf);
+}
+
+size_t HardwareSerial::println()
+{
+	return m_baud ? write("\r\n") : 0;
+}
+
+void HardwareSerial::simTick(unsigned long _elapsedUS)
+{
+	unsigned long long bitsPerByte = HardwareSerial_BITS_PER_BYTE * 1000000ULL;
+	char garble = (m_peerBaud && (m_peerBaud != m_baud)) ? 0x80 : 0;
+
+	if(!m_baud)
+	{
+		// Nobody listening
+		m_wire.clear();
+		return;
+	}
+
+	// Receive. A full UART buffer drops what arrives.
+	if(m_wire.empty())
+		m_receiveBits = 0;
+	else
+	{
+		m_receiveBits += (unsigned long long)m_baud * _elapsedUS;
+		while((m_receiveBits >= bitsPerByte) && !m_wire.empty())
+		{
+			m_receiveBits -= bitsPerByte;
+
+			if(m_receiveBuf.length() < (SERIAL_RX_BUFFER_SIZE - 1))
+				m_receiveBuf += m_wire[0] | garble;
+			else
+				m_receiveOverruns++;
+
+			m_wire.erase(0, 1);
+		}
+	}
+
+	// Transmit
+	if(m_transmitBuf.empty())
+		m_transmitBits = 0;
+	else
+	{
+		m_transmitBits += (unsigned long long)m_baud * _elapsedUS;
+		while((m_transmitBits >= bitsPerByte) && !m_transmitBuf.empty())
+		{
+			m_transmitBits -= bitsPerByte;
+			m_transmitted += m_transmitBuf[0] | garble;
+			m_transmitBuf.erase(0, 1);
+		}
+	}
+}
+
+void HardwareSerial::simReceive(const void *_data, size_t _length)
+{
+	m_wire.append((const char *)_data, _length);
+}
+
+std::string HardwareSerial::simTakeTransmitted()
+{
+	std::string transmitted;
+	transmitted.swap(m_transmitted);
+	return transmitted;
+}
+
+////////////////////////////////////////////////////////////
+// The simulation
+////////////////////////////////////////////////////////////
+CHostSim::CHostSim()
+{
+	m_nowUS = 0;
+	m_clockOffsetMS = 0;
+	m_loopPassUS = CHostSim_DEF_LOOP_PASS_US;
+
+	m_interruptsEnabled = true;
+	m_timerInterruptPending = false;
+
+	m_sleepEnabled = false;
+	m_asleepUS = 0;
+
+	for(int pin = 0; pin < NUM_DIGITAL_PINS; ++pin)
+	{
+		m_pinModes[pin] = INPUT;
+		m_pinValues[pin] = LOW;
+		m_pinDriven[pin] = false;
+		m_tones[pin] = 0;
+	}
+
+	m_pinWriteFunction = 0;
+	m_pinReadFunction = 0;
+}
+
+CHostSim::~CHostSim()
+{
+}
+
+void CHostSim::advanceUS(unsigned long long _us)
+{
+	unsigned long long endUS = m_nowUS + _us;
+
+	// If nothing can happen along the way, go straight there
+	if((!TIMER0_COMPA_vect || !(TIMSK0 & _BV(OCIE0A))) &&
+			Serial.simIdle() && Serial1.simIdle() && Serial2.simIdle() && Serial3.simIdle())
+	{
+		m_nowUS = endUS;
+		return;
+	}
+
+	// Step a millisecond at a time, the timer 0 tick
+	while(m_nowUS < endUS)
+	{
+		unsigned long long nextTickUS = ((m_nowUS / 1000ULL) + 1) * 1000ULL;
+		unsigned long long stepToUS = (nextTickUS < endUS) ? nextTickUS : endUS;
+		unsigned long elapsedUS = stepToUS - m_nowUS;
+
+		m_nowUS = stepToUS;
+
+		Serial.simTick(elapsedUS);
+		Serial1.simTick(elapsedUS);
+		Serial2.simTick(elapsedUS);
+		Serial3.simTick(elapsedUS);
+
+		if(m_nowUS == nextTickUS)
+			timerInterrupt();
+	}
+}
+
+uint32_t CHostSim::getMillis()
+{
+	return (uint32_t)((m_nowUS / 1000ULL) + m_clockOffsetMS);
+}
+
+uint32_t CHostSim::getMicros()
+{
+	return (uint32_t)(m_nowUS + (m_clockOffsetMS * 1000ULL));
+}
+
+void CHostSim::loopPass()
+{
+	loop();
+	advanceUS(m_loopPassUS);
+}
+
+void CHostSim::timerInterrupt()
+{
+	if(!TIMER0_COMPA_vect || !(TIMSK0 & _BV(OCIE0A)))
+		return;
+
+	// It runs when they come back on
+	if(!m_interruptsEnabled)
+	{
+		m_timerInterruptPending = true;
+		return;
+	}
+
+	// Interrupts are off inside an ISR
+	m_timerInterruptPending = false;
+	m_interruptsEnabled = false;
+	TIMER0_COMPA_vect();
+	m_interruptsEnabled = true;
+}
+
+void CHostSim::setInterrupts(bool _enabled)
+{
+	m_interruptsEnabled = _enabled;
+
+	if(m_interruptsEnabled && m_timerInterruptPending)
+		timerInterrupt();
+}
+
+void CHostSim::sleep()
+{
+	if(!m_sleepEnabled)
+		return;
+
+	// Until the next timer 0 tick
+	unsigned long long startUS = m_nowUS;
+	advanceUS(1000ULL - (m_nowUS % 1000ULL));
+	m_asleepUS += m_nowUS - startUS;
+}
+
+void CHostSim::setPin(uint8_t _pin, uint8_t _value)
+{
+	if(_pin >= NUM_DIGITAL_PINS)
+		return;
+
+	m_pinDriven[_pin] = true;
+	m_pinValues[_pin] = _value ? HIGH : LOW;
+}
+
+void CHostSim::releasePin(uint8_t _pin)
+{
+	if(_pin >= NUM_DIGITAL_PINS)
+		return;
+
+	m_pinDriven[_pin] = false;
+	if(m_pinModes[_pin] == INPUT_PULLUP)
+		m_pinValues[_pin] = HIGH;
+}
+
+uint8_t CHostSim::getPin(uint8_t _pin)
+{
+	return (_pin < NUM_DIGITAL_PINS) ? m_pinValues[_pin] : LOW;
+}
+
+void CHostSim::pinMode(uint8_t _pin, uint8_t _mode)
+{
+	if(_pin >= NUM_DIGITAL_PINS)
+		return;
+
+	m_pinModes[_pin] = _mode;
+	if((_mode == INPUT_PULLUP) && !m_pinDriven[_pin])
+		m_pinValues[_pin] = HIGH;
+}
+
+void CHostSim::digitalWrite(uint8_t _pin, uint8_t _value)
+{
+	if((_pin >= NUM_DIGITAL_PINS) || m_pinDriven[_pin])
+		return;
+
+	_value = _value ? HIGH : LOW;
+	if(m_pinValues[_pin] == _value)
+		return;
+
+	m_pinValues[_pin] = _value;
+	if(m_pinWriteFunction)
+		m_pinWriteFunction(_pin, _value);
+}
+
+int CHostSim::digitalRead(uint8_t _pin)
+{
+	if(m_pinReadFunction)
+		m_pinReadFunction(_pin);
+
+	return (_pin < NUM_DIGITAL_PINS) ? m_pinValues[_pin] : LOW;
+}
+
+void CHostSim::tone(uint8_t _pin, unsigned int _frequency)
+{
+	if(_pin < NUM_DIGITAL_PINS)
+		m_tones[_pin] = _frequency;
+}
+
+bool CHostSim::loadEEPROM(const char *_path)
+{
+	FILE *file = fopen(_path, "rb");
+	if(!file)
+		return false;
+
+	size_t count = fread(EEPROM.simData(), 1, EEPROM.length(), file);
+	fclose(file);
+
+	return (count == EEPROM.length());
+}
+
+bool CHostSim::saveEEPROM(const char *_path)
+{
+	FILE *file = fopen(_path, "wb");
+	if(!file)
+		return false;
+
+	size_t count = fwrite(EEPROM.simData(), 1, EEPROM.length(), file);
+	fclose(file);
+
+	return (count == EEPROM.length());
+}
@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////
+// Host simulation
+////////////////////////////////////////////////////////////
+#ifndef HostSim_h
+#define HostSim_h
+
+////////////////////////////////////////////////////////////
+// Runs the sketch on a PC against the shim Arduino core.
+// Virtual time starts at zero and only moves forward when
+// the simulation is advanced: each loop() pass costs
+// m_loopPassUS, delay() costs what it asks for, and idle
+// sleep skips to the next timer 0 interrupt. As time
+// passes the UARTs move bytes at their baud rates and the
+// timer 0 compare interrupt fires once a millisecond, if
+// the sketch has enabled it.
+////////////////////////////////////////////////////////////
+#define CHostSim_DEF_LOOP_PASS_US	(100)
+
+// Called when the sketch writes a pin
+typedef void (*CHostSim_PinWriteFunction)(uint8_t _pin, uint8_t _value);
+
+// Called just before the sketch reads a pin, so the
+// simulation can set it
+typedef void (*CHostSim_PinReadFunction)(uint8_t _pin);
+
+class CHostSim
+{
+protected:
+	unsigned long long m_nowUS;
+	unsigned long m_clockOffsetMS;
+	unsigned long m_loopPassUS;
+
+	bool m_interruptsEnabled;
+	bool m_timerInterruptPending;
+
+	bool m_sleepEnabled;
+	unsigned long long m_asleepUS;
+
+	uint8_t m_pinModes[NUM_DIGITAL_PINS];
+	uint8_t m_pinValues[NUM_DIGITAL_PINS];
+	bool m_pinDriven[NUM_DIGITAL_PINS];		// Set by the simulation
+	unsigned int m_tones[NUM_DIGITAL_PINS];
+	CHostSim_PinWriteFunction m_pinWriteFunction;
+	CHostSim_PinReadFunction m_pinReadFunction;
+
+	void timerInterrupt();
+
+public:
+	CHostSim();
+	virtual ~CHostSim();
+
+	// Time
+	void advanceUS(unsigned long long _us);
+	unsigned long long getElapsedUS()
+	{
+		return m_nowUS;
+	}
+
+	unsigned long long getAsleepUS()
+	{
+		return m_asleepUS;
+	}
+
+	// millis() reads this much ahead of the simulation clock,
+	// to test rollover
+	void setClockOffsetMS(unsigned long _offsetMS)
+	{
+		m_clockOffsetMS = _offsetMS;
+	}
+
+	uint32_t getMillis();
+	uint32_t getMicros();
+
+	void setLoopPassUS(unsigned long _us)
+	{
+		m_loopPassUS = _us;
+	}
+
+	// Run one loop() pass
+	void loopPass();
+
+	// Interrupts
+	void setInterrupts(bool _enabled);
+
+	// Sleep
+	void setSleepEnabled(bool _enabled)
+	{
+		m_sleepEnabled = _enabled;
+	}
+	void sleep();
+
+	// Pins. Inputs the simulation drives read back what it
+	// set; the rest read what the sketch wrote.
+	void setPin(uint8_t _pin, uint8_t _value);
+	void releasePin(uint8_t _pin);
+	uint8_t getPin(uint8_t _pin);
+
+	void setPinWriteFunction(CHostSim_PinWriteFunction _function)
+	{
+		m_pinWriteFunction = _function;
+	}
+
+	void setPinReadFunction(CHostSim_PinReadFunction _function)
+	{
+		m_pinReadFunction = _function;
+	}
+
+	unsigned int getTone(uint8_t _pin)
+	{
+		return (_pin < NUM_DIGITAL_PINS) ? m_tones[_pin] : 0;
+	}
+
+	// Called by the shim
+	void pinMode(uint8_t _pin, uint8_t _mode);
+	void digitalWrite(uint8_t _pin, uint8_t _value);
+	int digitalRead(uint8_t _pin);
+	void tone(uint8_t _pin, unsigned int _frequency);
+
+	// EEPROM image, so settings last between runs
+	bool loadEEPROM(const char *_path);
+	bool saveEEPROM(const char *_path);
+};
+
+extern CHostSim g_hostSim;
+
+// The sketch
+void setup();
+void loop();
+
+#endif
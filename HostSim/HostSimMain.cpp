@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////
+// Host simulation - command line runner
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "../Pins.h"
+
+#include "HostSim.h"
+#include "GPSReceiverSim.h"
+
+static FILE *s_captureFile = 0;
+static FILE *s_eventFile = 0;
+
+static void usage(const char *_name)
+{
+	fprintf(stderr, "Usage: %s [-s seconds] [-g gps.nmea] [-e eeprom.bin] [-p loopPassUS] [-o clockOffsetMS]\n", _name);
+	fprintf(stderr, "          [-c capture.bin] [-l relays.csv] [-r mtk|plain]\n");
+	fprintf(stderr, "  Runs the sketch in virtual time. Telemetry goes to stdout,\n");
+	fprintf(stderr, "  debug output to stderr. NMEA from the GPS file is fed to the\n");
+	fprintf(stderr, "  GPS port as fast as its baud rate allows, and the EEPROM image\n");
+	fprintf(stderr, "  is loaded before and saved after the run. A clock offset\n");
+	fprintf(stderr, "  starts millis() there, to test rollover. A capture build's\n");
+	fprintf(stderr, "  trace is saved with -c, and relay changes are logged with -l.\n");
+	fprintf(stderr, "  -r puts a simulated receiver on the GPS port instead of a file,\n");
+	fprintf(stderr, "  one that takes PMTK commands or one that ignores them.\n");
+	exit(1);
+}
+
+static void pinWritten(uint8_t _pin, uint8_t _value)
+{
+	if(!s_eventFile)
+		return;
+
+	if(_pin == PIN_LIGHT_RELAY)
+		fprintf(s_eventFile, "%lu,light,%s\n", (unsigned long)millis(), (_value == RELAY_ON) ? "on" : "off");
+	else if(_pin == PIN_DOOR_RELAY)
+		fprintf(s_eventFile, "%lu,door_relay,%s\n", (unsigned long)millis(), (_value == RELAY_ON) ? "on" : "off");
+}
+
+static void drainOutput()
+{
+	std::string capture = CAPTURE_SERIAL.simTakeTransmitted();
+	if(s_captureFile)
+		fwrite(capture.data(), 1, capture.length(), s_captureFile);
+
+	std::string telemetry = TELEMETRY_SERIAL.simTakeTransmitted();
+	fwrite(telemetry.data(), 1, telemetry.length(), stdout);
+
+	std::string debug = DEBUG_SERIAL.simTakeTransmitted();
+	fwrite(debug.data(), 1, debug.length(), stderr);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long seconds = 60;
+	const char *GPSPath = 0;
+	const char *EEPROMPath = 0;
+	CGPSReceiverSim *receiver = 0;
+
+	for(int arg = 1; arg < argc; ++arg)
+	{
+		if((arg + 1) >= argc)
+			usage(argv[0]);
+
+		if(!strcmp(argv[arg], "-s"))
+			seconds = strtoul(argv[++arg], 0, 10);
+		else if(!strcmp(argv[arg], "-g"))
+			GPSPath = argv[++arg];
+		else if(!strcmp(argv[arg], "-e"))
+			EEPROMPath = argv[++arg];
+		else if(!strcmp(argv[arg], "-p"))
+			g_hostSim.setLoopPassUS(strtoul(argv[++arg], 0, 10));
+		else if(!strcmp(argv[arg], "-o"))
+			g_hostSim.setClockOffsetMS(strtoul(argv[++arg], 0, 10));
+		else if(!strcmp(argv[arg], "-c"))
+		{
+			if(!(s_captureFile = fopen(argv[++arg], "wb")))
+			{
+				perror(argv[arg]);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[arg], "-r"))
+		{
+			const char *type = argv[++arg];
+			if(strcmp(type, "mtk") && strcmp(type, "plain"))
+				usage(argv[0]);
+			receiver = new CGPSReceiverSim(GPS_SERIAL, !strcmp(type, "mtk"));
+		}
+		else if(!strcmp(argv[arg], "-l"))
+		{
+			if(!(s_eventFile = fopen(argv[++arg], "w")))
+			{
+				perror(argv[arg]);
+				return 1;
+			}
+			g_hostSim.setPinWriteFunction(pinWritten);
+		}
+		else
+			usage(argv[0]);
+	}
+
+	if(GPSPath && receiver)
+		usage(argv[0]);
+
+	FILE *GPSFile = 0;
+	if(GPSPath && !(GPSFile = fopen(GPSPath, "rb")))
+	{
+		perror(GPSPath);
+		return 1;
+	}
+
+	if(EEPROMPath)
+		g_hostSim.loadEEPROM(EEPROMPath);
+
+	setup();
+
+	unsigned long long endUS = seconds * 1000000ULL;
+	while(g_hostSim.getElapsedUS() < endUS)
+	{
+		// Keep the GPS wire busy
+		if(GPSFile && (GPS_SERIAL.simBytesOnWire() < SERIAL_RX_BUFFER_SIZE))
+		{
+			char line[256];
+			if(fgets(line, sizeof(line), GPSFile))
+				GPS_SERIAL.simReceive(line, strlen(line));
+		}
+
+		g_hostSim.loopPass();
+		if(receiver)
+			receiver->tick();
+		drainOutput();
+	}
+
+	drainOutput();
+
+	if(EEPROMPath)
+		g_hostSim.saveEEPROM(EEPROMPath);
+
+	fprintf(stderr, "\nHostSim: %lu s simulated, %.1f%% asleep, GPS UART overruns %lu\n",
+			seconds, (100.0 * g_hostSim.getAsleepUS()) / g_hostSim.getElapsedUS(),
+			GPS_SERIAL.simReceiveOverruns());
+
+	if(receiver)
+	{
+		receiver->printStats(stderr);
+		delete receiver;
+	}
+
+	if(GPSFile)
+		fclose(GPSFile);
+
+	if(s_captureFile)
+		fclose(s_captureFile);
+
+	if(s_eventFile)
+		fclose(s_eventFile);
+
+	return 0;
+}
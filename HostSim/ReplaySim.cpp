@@ -0,0 +1,301 @@
+////////////////////////////////////////////////////////////
+// Host simulation - replay a captured input trace
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+#include <Arduino.h>
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "../ICommInterface.h"
+#include "../TelemetryTags.h"
+#include "../Telemetry.h"
+#include "../MilliTimer.h"
+#include "../TelemetryScheduler.h"
+#include "../TaskScheduler.h"
+
+#include "../Pins.h"
+#include "../SunCalc.h"
+#include "../DoorController.h"
+#include "../LightController.h"
+#include "../BeepController.h"
+#include "../GaryCooper.h"
+#include "../InputCapture.h"
+
+#include "HostSim.h"
+
+extern CGPSParser g_GPSParser;
+
+////////////////////////////////////////////////////////////
+// Feeds a trace from a GARY_COOPER_INPUT_CAPTURE build back
+// into the sketch. Nothing goes through the UARTs: GPS data
+// goes to receiveGPSData() and telemetry to
+// CTelemetry::parse(), each at the millis() it was captured.
+// In between, time jumps from one task deadline to the
+// next, so a week takes seconds. The door switches are
+// answered from the trace as they are read: a recorded
+// mask is what was read at that millis(). Relay changes are
+// written to stdout as CSV:
+//
+//   millis,device,state
+//
+// Timers are lined up at the end of setup(), so the tasks
+// see the input at the same times they did on the board.
+////////////////////////////////////////////////////////////
+struct CReplayRecord
+{
+	inputCaptureStreamE m_stream;
+	uint32_t m_ms;				// Captured millis()
+	unsigned int m_len;
+	const unsigned char *m_data;
+};
+
+static std::vector<CReplayRecord> s_switchRecords;
+static size_t s_nextSwitchRecord = 0;
+
+// Captured millis() less ours, from the setup record
+static bool s_aligned = false;
+static uint32_t s_offsetMS = 0;
+
+static void logEvent(const char *_device, const char *_state)
+{
+	printf("%lu,%s,%s\n", (unsigned long)millis(), _device, _state);
+}
+
+static void pinWritten(uint8_t _pin, uint8_t _value)
+{
+	if(_pin == PIN_LIGHT_RELAY)
+		logEvent("light", (_value == RELAY_ON) ? "on" : "off");
+	else if(_pin == PIN_DOOR_RELAY)
+		logEvent("door_relay", (_value == RELAY_ON) ? "on" : "off");
+}
+
+// Run the scheduled tasks that are due before _ms
+static void runUntil(uint32_t _ms)
+{
+	for(;;)
+	{
+		long remaining = (int32_t)(_ms - millis());
+		unsigned long wait = g_taskScheduler.timeToNextDeadline();
+
+		if((remaining <= 0) || (wait >= (unsigned long)remaining))
+		{
+			if(remaining > 0)
+				g_hostSim.advanceUS(remaining * 1000ULL);
+			return;
+		}
+
+		g_hostSim.advanceUS(wait * 1000ULL);
+		g_taskScheduler.tick();
+	}
+}
+
+static int getInt16(const unsigned char *_buf)
+{
+	return (int16_t)(_buf[0] | (_buf[1] << 8));
+}
+
+static double getFloat(const unsigned char *_buf)
+{
+	float value;
+	memcpy(&value, _buf, sizeof(value));
+	return value;
+}
+
+static void applySettings(const unsigned char *_settings)
+{
+	g_doorController.setSunriseOffset(getInt16(_settings + 0));
+	g_doorController.setSunsetOffset(getInt16(_settings + 2));
+	g_doorController.setStuckDoorDelay(getInt16(_settings + 4));
+	g_lightController.setMinimumDayLength(getFloat(_settings + 6));
+	g_lightController.setExtraLightTimeMorning(getFloat(_settings + 10));
+	g_lightController.setExtraLightTimeEvening(getFloat(_settings + 14));
+}
+
+static void applySwitches(unsigned char _switches)
+{
+	// Active low
+	g_hostSim.setPin(PIN_DOOR_OPEN_SWITCH, (_switches & 1) ? LOW : HIGH);
+	g_hostSim.setPin(PIN_DOOR_CLOSED_SWITCH, (_switches & 2) ? LOW : HIGH);
+}
+
+static void applyNextSwitches()
+{
+	const CReplayRecord &record = s_switchRecords[s_nextSwitchRecord++];
+	applySwitches(record.m_len ? record.m_data[0] : 0);
+}
+
+static void pinRead(uint8_t _pin)
+{
+	if(!s_aligned || ((_pin != PIN_DOOR_OPEN_SWITCH) && (_pin != PIN_DOOR_CLOSED_SWITCH)))
+		return;
+
+	while((s_nextSwitchRecord < s_switchRecords.size()) &&
+			((int32_t)(s_switchRecords[s_nextSwitchRecord].m_ms - s_offsetMS - millis()) <= 0))
+		applyNextSwitches();
+}
+
+// The debug output stays open so its prints take as long as
+// they did on the board, and is thrown away unless wanted
+static void drainDebug(bool _verbose)
+{
+	std::string debug = Serial.simTakeTransmitted();
+	if(_verbose)
+		fwrite(debug.data(), 1, debug.length(), stderr);
+}
+
+static void usage(const char *_name)
+{
+	fprintf(stderr, "Usage: %s [-v] trace.bin\n", _name);
+	fprintf(stderr, "  Replays a captured trace and writes relay changes as CSV on stdout.\n");
+	fprintf(stderr, "  -v writes the debug output to stderr.\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	bool verbose = false;
+	const char *tracePath = 0;
+
+	for(int arg = 1; arg < argc; ++arg)
+	{
+		if(!strcmp(argv[arg], "-v"))
+			verbose = true;
+		else if(!tracePath)
+			tracePath = argv[arg];
+		else
+			usage(argv[0]);
+	}
+
+	if(!tracePath)
+		usage(argv[0]);
+
+	// Traces are small enough to read in one go, which lets
+	// the switches be looked ahead
+	FILE *trace = fopen(tracePath, "rb");
+	if(!trace)
+	{
+		perror(tracePath);
+		return 1;
+	}
+
+	std::vector<unsigned char> buf;
+	unsigned char chunk[4096];
+	size_t chunkLen;
+	while((chunkLen = fread(chunk, 1, sizeof(chunk), trace)) > 0)
+		buf.insert(buf.end(), chunk, chunk + chunkLen);
+	fclose(trace);
+
+	if((buf.size() < 5) || memcmp(&buf[0], "GCTR", 4) || (buf[4] != CInputCapture_VERSION))
+	{
+		fprintf(stderr, "%s: not a version %d capture\n", tracePath, CInputCapture_VERSION);
+		return 1;
+	}
+
+	// Up to the second setup record, if the controller restarted
+	std::vector<CReplayRecord> records;
+	size_t setupRecord = 0;
+	bool haveSetup = false;
+
+	for(size_t pos = 5; pos < buf.size();)
+	{
+		if((pos + 6) > buf.size() || (pos + 6 + buf[pos + 5]) > buf.size())
+		{
+			fprintf(stderr, "%s: truncated\n", tracePath);
+			break;
+		}
+
+		CReplayRecord record;
+		record.m_stream = (inputCaptureStreamE)buf[pos];
+		record.m_ms = buf[pos + 1] | ((uint32_t)buf[pos + 2] << 8) |
+					  ((uint32_t)buf[pos + 3] << 16) | ((uint32_t)buf[pos + 4] << 24);
+		record.m_len = buf[pos + 5];
+		record.m_data = &buf[pos + 6];
+		pos += 6 + record.m_len;
+
+		if(record.m_stream == inputCapture_setup)
+		{
+			if(haveSetup)
+			{
+				fprintf(stderr, "%s: the controller restarted at %lu ms, stopping\n", tracePath, (unsigned long)record.m_ms);
+				break;
+			}
+
+			setupRecord = records.size();
+			haveSetup = true;
+		}
+		else if(record.m_stream == inputCapture_doorSwitches)
+			s_switchRecords.push_back(record);
+
+		records.push_back(record);
+	}
+
+	if(!haveSetup)
+	{
+		fprintf(stderr, "%s: no setup record\n", tracePath);
+		return 1;
+	}
+
+	clock_t start = clock();
+
+	// Until the first read, the switches are as first read
+	if(s_switchRecords.size())
+		applyNextSwitches();
+	else
+		applySwitches(0);
+
+	g_hostSim.setPinWriteFunction(pinWritten);
+	g_hostSim.setPinReadFunction(pinRead);
+	setup();
+
+	// Input comes from the trace, not the UARTs
+	TIMSK0 &= ~_BV(OCIE0A);
+
+	s_offsetMS = records[setupRecord].m_ms - millis();
+	s_aligned = true;
+
+	// loop()'s first pass loads the settings, writing a lot of
+	// debug output, before the first tasks run. Do it the same.
+	loop();
+	drainDebug(verbose);
+
+	unsigned long long bytes = 0;
+	for(size_t index = setupRecord + 1; index < records.size(); ++index)
+	{
+		const CReplayRecord &record = records[index];
+
+		runUntil(record.m_ms - s_offsetMS);
+
+		switch(record.m_stream)
+		{
+		case inputCapture_settings:
+			if(record.m_len == CInputCapture_SETTINGS_LEN)
+				applySettings(record.m_data);
+			break;
+
+		case inputCapture_GPS:
+			receiveGPSData((unsigned char *)record.m_data, record.m_len);
+			break;
+
+		case inputCapture_telemetry:
+			g_telemetry.parse(record.m_data, record.m_len);
+			break;
+
+		default:
+			break;
+		}
+
+		drainDebug(verbose);
+		bytes += record.m_len;
+	}
+
+	fprintf(stderr, "ReplaySim: %lu records, %llu bytes, %.1f s of input replayed in %.3f s\n",
+			(unsigned long)(records.size() - setupRecord - 1), bytes, millis() / 1000.0,
+			(double)(clock() - start) / CLOCKS_PER_SEC);
+
+	return 0;
+}
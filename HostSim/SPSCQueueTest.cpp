@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////
+// Host test - CSPSCQueue with a producer and consumer thread
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "../SPSCQueue.h"
+
+////////////////////////////////////////////////////////////
+// On the board the producer is an ISR and the consumer is
+// loop(). Here they are two threads, which run at the same
+// time and so are harder on the queue than an ISR ever is.
+//
+// The queue only has compiler barriers. That is enough on
+// the AVR, and on x86, where stores are seen in order. On a
+// weaker host (ARM) this test may fail without the queue
+// being wrong for the board.
+//
+// The producer pushes a running count, and retries a byte
+// the queue turned away. The consumer checks that the count
+// comes out unbroken, so nothing was lost, repeated or
+// reordered, and that the overruns match the producer's
+// retries.
+////////////////////////////////////////////////////////////
+#define TEST_CAPACITY	(64)
+
+static int s_failures = 0;
+
+#define CHECK(_test) \
+	do \
+	{ \
+		if(!(_test)) \
+		{ \
+			fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #_test); \
+			s_failures++; \
+		} \
+	} \
+	while(0)
+
+// Full and empty, with one thread
+static void testBoundaries()
+{
+	CSPSCQueue<TEST_CAPACITY> queue;
+	unsigned char c;
+	unsigned char buf[TEST_CAPACITY];
+	const unsigned char *data;
+
+	// Empty
+	CHECK(queue.bytesAvailable() == 0);
+	CHECK(!queue.pop(c));
+	CHECK(queue.read(buf, sizeof(buf)) == 0);
+	CHECK(queue.peek(data) == 0);
+
+	// Holds one less than its capacity
+	for(int i = 0; i < (TEST_CAPACITY - 1); ++i)
+		CHECK(queue.push((unsigned char)i));
+	CHECK(queue.bytesAvailable() == (TEST_CAPACITY - 1));
+	CHECK(queue.getOverruns() == 0);
+
+	// Full drops and counts
+	CHECK(!queue.push(0xAA));
+	CHECK(!queue.push(0xAA));
+	CHECK(queue.getOverruns() == 2);
+	CHECK(queue.bytesAvailable() == (TEST_CAPACITY - 1));
+
+	// Room again after popping, and the new bytes wrap
+	// around to the front of the buffer
+	CHECK(queue.pop(c) && (c == 0));
+	CHECK(queue.pop(c) && (c == 1));
+	CHECK(queue.push(TEST_CAPACITY - 1));
+	CHECK(queue.push(TEST_CAPACITY));
+	CHECK(!queue.push(0xAA));
+	CHECK(queue.getOverruns() == 3);
+
+	// Comes out in order. peek() stops at the end of the buffer.
+	unsigned int run = queue.peek(data);
+	CHECK(run == (TEST_CAPACITY - 2));
+	CHECK((data[0] == 2) && (data[run - 1] == (TEST_CAPACITY - 1)));
+	queue.consume(run);
+	CHECK(queue.bytesAvailable() == 1);
+	CHECK(queue.peek(data) == 1);
+	CHECK(data[0] == TEST_CAPACITY);
+	CHECK(queue.read(buf, sizeof(buf)) == 1);
+	CHECK(buf[0] == TEST_CAPACITY);
+
+	// Empty again
+	CHECK(queue.bytesAvailable() == 0);
+	CHECK(!queue.pop(c));
+	CHECK(queue.getOverruns() == 3);
+}
+
+// Sometimes slow, so the queue fills
+static void dawdle(unsigned long _count)
+{
+	if((_count % 4096) < 64)
+	{
+		for(volatile int i = 0; i < 200; ++i)
+			;
+	}
+}
+
+static CSPSCQueue<TEST_CAPACITY> s_queue;
+static unsigned long s_retries;
+
+static void producer(unsigned long _bytes)
+{
+	unsigned long retries = 0;
+
+	for(unsigned long sent = 0; sent < _bytes; )
+	{
+		if(s_queue.push((unsigned char)sent))
+			sent++;
+		else
+		{
+			// Let the consumer run if there is only one CPU
+			retries++;
+			std::this_thread::yield();
+		}
+	}
+
+	s_retries = retries;
+}
+
+// Takes bytes with pop(), read() and peek() / consume() in turn
+static void consumer(unsigned long _bytes)
+{
+	unsigned long received = 0;
+	unsigned long mismatches = 0;
+	unsigned char buf[TEST_CAPACITY];
+	const unsigned char *data;
+	unsigned int count;
+
+	while(received < _bytes)
+	{
+		switch(received % 3)
+		{
+		case 0:
+			count = s_queue.pop(buf[0]) ? 1 : 0;
+			data = buf;
+			break;
+
+		case 1:
+			count = s_queue.read(buf, 1 + (received % sizeof(buf)));
+			data = buf;
+			break;
+
+		default:
+			count = s_queue.peek(data);
+			break;
+		}
+
+		for(unsigned int i = 0; i < count; ++i)
+		{
+			if(data[i] != (unsigned char)(received + i))
+				mismatches++;
+		}
+
+		if(data != buf)
+			s_queue.consume(count);
+
+		if(!count)
+			std::this_thread::yield();
+
+		received += count;
+		dawdle(received);
+	}
+
+	CHECK(received == _bytes);
+	CHECK(mismatches == 0);
+}
+
+static void testThreads(unsigned long _bytes)
+{
+	std::thread consumerThread(consumer, _bytes);
+	std::thread producerThread(producer, _bytes);
+
+	producerThread.join();
+	consumerThread.join();
+
+	CHECK(s_queue.bytesAvailable() == 0);
+	CHECK(s_queue.getOverruns() == (unsigned int)s_retries);
+
+	// The consumer has to fall behind for this to mean anything
+	CHECK(s_retries > 0);
+
+	printf("%lu bytes through a %d byte queue, %lu pushes turned away\n",
+		   _bytes, TEST_CAPACITY, s_retries);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long bytes = 1000000;
+
+	if(argc == 3 && !strcmp(argv[1], "-n"))
+		bytes = strtoul(argv[2], 0, 10);
+	else if(argc != 1)
+	{
+		fprintf(stderr, "usage: %s [-n bytes]\n", argv[0]);
+		return 1;
+	}
+
+	testBoundaries();
+	testThreads(bytes);
+
+	if(s_failures)
+	{
+		printf("%d checks failed\n", s_failures);
+		return 1;
+	}
+
+	printf("passed\n");
+	return 0;
+}
@@ -0,0 +1,301 @@
+////////////////////////////////////////////////////////////
+// Host simulation - year long door and light schedule
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <Arduino.h>
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "../ICommInterface.h"
+#include "../TelemetryTags.h"
+#include "../Telemetry.h"
+#include "../MilliTimer.h"
+#include "../TelemetryScheduler.h"
+#include "../TaskScheduler.h"
+
+#include "../Pins.h"
+#include "../SunCalc.h"
+#include "../DoorController.h"
+#include "../LightController.h"
+#include "../BeepController.h"
+#include "../GaryCooper.h"
+#include "../GPSClock.h"
+
+#include "HostSim.h"
+
+////////////////////////////////////////////////////////////
+// Steps the GPS time through a year a minute at a time and
+// runs the same checks the sketch runs each minute, against
+// a simulated door that takes a while to travel. Door and
+// light changes are written as CSV:
+//
+//   date,time_utc,device,state
+//   2026-03-01,11:42,door,open
+//
+// With -b they are also written to a file in binary:
+//
+//   Header:	'G' 'C' 'T' 'L' version, year (2 bytes)
+//   Record:	minute of the year (4 bytes), event
+//
+// The minute of the year counts from 00:00 UTC on January 1.
+// Multi-byte values are little endian.
+//
+// The serial ports are never opened, so debug output costs
+// almost nothing and idle time is skipped.
+////////////////////////////////////////////////////////////
+#define ScheduleSim_DOOR_TRAVEL_MS	(10000)
+#define ScheduleSim_DOOR_TICK_MS	(CDoorController_TICK_MS)
+#define ScheduleSim_MAX_SETTLE_MS	(60000)
+#define ScheduleSim_BINARY_VERSION	(1)
+
+// Binary timeline events
+typedef enum
+{
+	scheduleEvent_doorClosed = 0,
+	scheduleEvent_doorOpen,
+	scheduleEvent_lightOff,
+	scheduleEvent_lightOn
+} scheduleEventE;
+
+static CGPSParserData s_GPSData;
+
+// The door as it really is
+static bool s_doorOpen = false;
+static bool s_doorMoving = false;
+static uint32_t s_doorArrivalMS = 0;
+
+static unsigned long s_doorChanges = 0;
+static unsigned long s_lightChanges = 0;
+
+static FILE *s_binaryFile = 0;
+static unsigned long s_minuteOfYear = 0;
+
+static void writeLittleEndian(unsigned long _value, int _len)
+{
+	for(int index = 0; index < _len; ++index)
+		fputc((_value >> (8 * index)) & 0xFF, s_binaryFile);
+}
+
+static void logEvent(const char *_device, const char *_state, scheduleEventE _event)
+{
+	printf("%04d-%02d-%02d,%02d:%02d,%s,%s\n",
+		   s_GPSData.m_date.m_year, s_GPSData.m_date.m_month, s_GPSData.m_date.m_day,
+		   s_GPSData.m_time.m_hour, s_GPSData.m_time.m_minute, _device, _state);
+
+	if(s_binaryFile)
+	{
+		writeLittleEndian(s_minuteOfYear, 4);
+		fputc(_event, s_binaryFile);
+	}
+}
+
+static void setDoorSwitches()
+{
+	// Active low
+	g_hostSim.setPin(PIN_DOOR_OPEN_SWITCH, (!s_doorMoving && s_doorOpen) ? LOW : HIGH);
+	g_hostSim.setPin(PIN_DOOR_CLOSED_SWITCH, (!s_doorMoving && !s_doorOpen) ? LOW : HIGH);
+}
+
+static void pinWritten(uint8_t _pin, uint8_t _value)
+{
+	if(_pin == PIN_LIGHT_RELAY)
+	{
+		if(_value == RELAY_ON)
+			logEvent("light", "on", scheduleEvent_lightOn);
+		else
+			logEvent("light", "off", scheduleEvent_lightOff);
+		s_lightChanges++;
+	}
+	else if((_pin == PIN_DOOR_RELAY) && (_value == RELAY_ON) && !s_doorMoving)
+	{
+		// Like a garage door button, it goes the other way
+		s_doorMoving = true;
+		s_doorArrivalMS = millis() + ScheduleSim_DOOR_TRAVEL_MS;
+		setDoorSwitches();
+	}
+}
+
+static void moveDoor()
+{
+	if(!s_doorMoving || ((int32_t)(millis() - s_doorArrivalMS) < 0))
+		return;
+
+	s_doorMoving = false;
+	s_doorOpen = !s_doorOpen;
+	setDoorSwitches();
+
+	if(s_doorOpen)
+		logEvent("door", "open", scheduleEvent_doorOpen);
+	else
+		logEvent("door", "closed", scheduleEvent_doorClosed);
+	s_doorChanges++;
+}
+
+// Tick the door until it has stopped
+static void settleDoor()
+{
+	uint32_t startMS = millis();
+
+	do
+	{
+		g_hostSim.advanceUS(ScheduleSim_DOOR_TICK_MS * 1000ULL);
+		moveDoor();
+		g_taskScheduler.tick();
+	}
+	while((s_doorMoving || (getDoorMotor()->getDoorState() == doorState_moving)) &&
+			((millis() - startMS) < ScheduleSim_MAX_SETTLE_MS));
+}
+
+static bool isLeapYear(int _year)
+{
+	return (!(_year % 4) && (_year % 100)) || !(_year % 400);
+}
+
+static int daysInMonth(int _year, int _month)
+{
+	static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	return ((_month == 2) && isLeapYear(_year)) ? 29 : days[_month - 1];
+}
+
+static void usage(const char *_name)
+{
+	fprintf(stderr, "Usage: %s -a lat -o lon [-y year] [-r sunriseOffsetMin] [-s sunsetOffsetMin]\n", _name);
+	fprintf(stderr, "          [-d minDayLengthHours] [-m morningExtraHours] [-e eveningExtraHours]\n");
+	fprintf(stderr, "          [-b timeline.bin]\n");
+	fprintf(stderr, "  Writes the door and light changes for the year as CSV on stdout,\n");
+	fprintf(stderr, "  and in binary to the -b file.\n");
+	exit(1);
+}
+
+static void check(telemetrycommandResponseE _response, const char *_what)
+{
+	if(_response != telemetry_cmd_response_ack)
+	{
+		fprintf(stderr, "Invalid %s\n", _what);
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int year = 2026;
+	double lat = GPS_INVALID_DATA;
+	double lon = GPS_INVALID_DATA;
+	bool haveLat = false;
+	bool haveLon = false;
+
+	for(int arg = 1; arg < argc; ++arg)
+	{
+		if((arg + 1) >= argc)
+			usage(argv[0]);
+
+		const char *option = argv[arg];
+		const char *value = argv[++arg];
+
+		if(!strcmp(option, "-y"))
+			year = atoi(value);
+		else if(!strcmp(option, "-a"))
+		{
+			lat = atof(value);
+			haveLat = true;
+		}
+		else if(!strcmp(option, "-o"))
+		{
+			lon = atof(value);
+			haveLon = true;
+		}
+		else if(!strcmp(option, "-r"))
+			check(g_doorController.setSunriseOffset(atoi(value)), "sunrise offset");
+		else if(!strcmp(option, "-s"))
+			check(g_doorController.setSunsetOffset(atoi(value)), "sunset offset");
+		else if(!strcmp(option, "-d"))
+			check(g_lightController.setMinimumDayLength(atof(value)), "minimum day length");
+		else if(!strcmp(option, "-m"))
+			check(g_lightController.setExtraLightTimeMorning(atof(value)), "morning extra light");
+		else if(!strcmp(option, "-e"))
+			check(g_lightController.setExtraLightTimeEvening(atof(value)), "evening extra light");
+		else if(!strcmp(option, "-b"))
+		{
+			if(!(s_binaryFile = fopen(value, "wb")))
+			{
+				perror(value);
+				exit(1);
+			}
+		}
+		else
+			usage(argv[0]);
+	}
+
+	if(!haveLat || !haveLon)
+		usage(argv[0]);
+
+	clock_t start = clock();
+
+	// The door starts closed
+	setDoorSwitches();
+	g_doorController.setup(g_taskScheduler);
+	g_lightController.setup();
+	g_hostSim.setPinWriteFunction(pinWritten);
+	settleDoor();
+
+	s_GPSData.clear();
+	s_GPSData.m_GPSLocked = true;
+	s_GPSData.m_position.m_lat = lat;
+	s_GPSData.m_position.m_lon = lon;
+	s_GPSData.m_date.m_year = year;
+	s_GPSData.m_time.m_second = 0;
+
+	printf("date,time_utc,device,state\n");
+
+	if(s_binaryFile)
+	{
+		fputs("GCTL", s_binaryFile);
+		fputc(ScheduleSim_BINARY_VERSION, s_binaryFile);
+		writeLittleEndian(year, 2);
+	}
+
+	uint32_t lastCheckMS = millis();
+	for(int month = 1; month <= 12; ++month)
+	{
+		for(int day = 1; day <= daysInMonth(year, month); ++day)
+		{
+			for(int minute = 0; minute < (24 * 60); ++minute)
+			{
+				s_GPSData.m_date.m_month = month;
+				s_GPSData.m_date.m_day = day;
+				s_GPSData.m_time.m_hour = minute / 60;
+				s_GPSData.m_time.m_minute = minute % 60;
+
+				// Keep the checks on the GPS minute, so the
+				// clock doesn't see settling as drift
+				uint32_t settledMS = millis() - lastCheckMS;
+				if(settledMS < 60000UL)
+					g_hostSim.advanceUS((60000UL - settledMS) * 1000ULL);
+				lastCheckMS = millis();
+
+				// What receiveGPSData() and timeCheckTask() do
+				g_GPSClock.update(s_GPSData);
+				if(g_sunCalc.processGPSData(s_GPSData))
+				{
+					g_doorController.checkTime();
+					g_lightController.checkTime();
+				}
+
+				settleDoor();
+				s_minuteOfYear++;
+			}
+		}
+	}
+
+	fprintf(stderr, "ScheduleSim: %lu minutes, %lu door changes, %lu light changes, %lu sun times figured, %lu reused, %.3f s\n",
+			s_minuteOfYear, s_doorChanges, s_lightChanges, g_sunCalc.getCacheMisses(), g_sunCalc.getCacheHits(),
+			(double)(clock() - start) / CLOCKS_PER_SEC);
+
+	if(s_binaryFile)
+		fclose(s_binaryFile);
+
+	return 0;
+}
@@ -0,0 +1,501 @@
+////////////////////////////////////////////////////////////
+// Host benchmark - ASCII telemetry sentence assembly
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../ICommInterface.h"
+#include "../Telemetry.h"
+
+////////////////////////////////////////////////////////////
+// Times the ASCII sentence path against the one it replaced,
+// which sent every term to the comm interface on its own and
+// formatted doubles digit by digit with pow(). Both paths
+// build the same sentences into a port that only keeps the
+// last one, and the two are compared before any timing.
+// The old DtoA() truncates, so 11.25 can come out as 11.249;
+// terms only have to agree to the second decimal place.
+//
+// The host is much faster than the board, so only the ratio
+// between the paths means anything.
+////////////////////////////////////////////////////////////
+
+// Keeps the last sentence written and throws the rest away
+class CBenchPort : public ICommunicationInterface
+{
+public:
+	char m_sentence[CTelemetry_SENTENCESIZE * 2];
+	unsigned int m_length;
+	unsigned long m_bytes;
+
+	CBenchPort()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		m_length = 0;
+		m_sentence[0] = '\0';
+		m_bytes = 0;
+	}
+
+	void append(const unsigned char *_pBuf, unsigned int _iBufSize)
+	{
+		// A new sentence starts with '$'
+		if(_iBufSize && (_pBuf[0] == '$'))
+			m_length = 0;
+
+		if((m_length + _iBufSize) < sizeof(m_sentence))
+		{
+			memcpy(m_sentence + m_length, _pBuf, _iBufSize);
+			m_length += _iBufSize;
+			m_sentence[m_length] = '\0';
+		}
+
+		m_bytes += _iBufSize;
+	}
+
+	unsigned int read(unsigned char *, unsigned int, bool)
+	{
+		return 0;
+	}
+	unsigned int write(const unsigned char *_pBuf, unsigned int _iBufSize)
+	{
+		append(_pBuf, _iBufSize);
+		return _iBufSize;
+	}
+	unsigned int writeUrgent(const unsigned char *_pBuf, unsigned int _iBufSize)
+	{
+		append(_pBuf, _iBufSize);
+		return _iBufSize;
+	}
+	void setTransmitDelimiter(unsigned char) {}
+	int getError()
+	{
+		return 0;
+	}
+	int bytesInReceiveBuffer()
+	{
+		return 0;
+	}
+	int bytesInTransmitBuffer()
+	{
+		return 0;
+	}
+	unsigned int bytesFreeInTransmitBuffer()
+	{
+		return 0xFFFF;
+	}
+	unsigned int bytesFreeInUrgentTransmitBuffer()
+	{
+		return 0xFFFF;
+	}
+	unsigned int discardTransmitRecords(unsigned int, unsigned char)
+	{
+		return 0;
+	}
+	void setReceiveSink(ICommunicationSink *) {}
+	int gets(char *, int)
+	{
+		return 0;
+	}
+	bool puts(const char *_pBuf)
+	{
+		append((const unsigned char *)_pBuf, strlen(_pBuf));
+		return true;
+	}
+	void tick() {}
+};
+
+////////////////////////////////////////////////////////////
+// The old path, as it was before sentences were assembled
+// in place
+////////////////////////////////////////////////////////////
+static char *Old_DtoA(char *str, double num, int places)
+{
+	double precision = (1.0) / (pow(10, (double)(places + 1)));
+
+	// handle special cases
+	if (isnan(num))
+	{
+		strcpy(str, "nan");
+	}
+	else if (isinf(num))
+	{
+		strcpy(str, "inf");
+	}
+	else if (num == 0.0)
+	{
+		strcpy(str, "0");
+	}
+	else
+	{
+		int digit, m;
+		int m1 = 0;
+		char *c = str;
+		int neg = (num < 0);
+		if (neg)
+		{
+			num = -num;
+		}
+		// calculate magnitude
+		m = log10(num);
+		int useExp = (m >= 14 || (neg && m >= 9) || m <= -9);
+		if (neg)
+		{
+			*(c++) = '-';
+		}
+		// set up for scientific notation
+		if (useExp)
+		{
+			if (m < 0)
+			{
+				m -= 1.0;
+			}
+			num = num / pow(10.0, m);
+			m1 = m;
+			m = 0;
+		}
+		if (m < 1.0)
+		{
+			m = 0;
+		}
+		// convert the number
+		while (num > precision || m >= 0)
+		{
+			double weight = pow(10.0, m);
+			if (weight > 0 && !isinf(weight))
+			{
+				digit = floor(num / weight);
+				num -= (digit * weight);
+				*(c++) = '0' + digit;
+			}
+			if (m == 0 && num > 0)
+			{
+				*(c++) = '.';
+			}
+			m--;
+		}
+		if (useExp)
+		{
+			// convert the exponent
+			int i, j;
+			*(c++) = 'e';
+			if (m1 > 0)
+			{
+				*(c++) = '+';
+			}
+			else
+			{
+				*(c++) = '-';
+				m1 = -m1;
+			}
+			m = 0;
+			while (m1 > 0)
+			{
+				*(c++) = '0' + m1 % 10;
+				m1 /= 10;
+				m++;
+			}
+			c -= m;
+			for (i = 0, j = m - 1; i < j; i++, j--)
+			{
+				// swap without temporary
+				c[i] ^= c[j];
+				c[j] ^= c[i];
+				c[i] ^= c[j];
+			}
+			c += m;
+		}
+		*(c) = '\0';
+	}
+	return str;
+}
+
+static void Old_Reverse(char str[], int length)
+{
+	int start = 0;
+	int end = length - 1;
+	while (start < end)
+	{
+		char tmp = str[start];
+		str[start] = str[end];
+		str[end] = tmp;
+		start++;
+		end--;
+	}
+}
+
+static char *Old_ItoA(int num, char *str, int base)
+{
+	int i = 0;
+	bool isNegative = false;
+
+	if (num == 0)
+	{
+		str[i++] = '0';
+		str[i] = '\0';
+		return str;
+	}
+
+	if (num < 0 && base == 10)
+	{
+		isNegative = true;
+		num = -num;
+	}
+
+	while (num != 0)
+	{
+		int rem = num % base;
+		str[i++] = (rem > 9) ? (rem - 10) + 'a' : rem + '0';
+		num = num / base;
+	}
+
+	if (isNegative)
+		str[i++] = '-';
+
+	str[i] = '\0';
+
+	Old_Reverse(str, i);
+
+	return str;
+}
+
+class COldTelemetry
+{
+protected:
+	ICommunicationInterface *m_commInterface;
+	int m_transmitTermNumber;
+	int m_transmitChecksum;
+
+public:
+	COldTelemetry(ICommunicationInterface *_commInterface)
+	{
+		m_commInterface = _commInterface;
+		m_transmitTermNumber = 0;
+		m_transmitChecksum = 0;
+	}
+
+	void transmissionStart()
+	{
+		m_transmitTermNumber = 0;
+		m_transmitChecksum = 0;
+
+		m_commInterface->puts("$");
+		m_commInterface->tick();
+	}
+
+	void sendTerm(const char *_value)
+	{
+		char termBuf[CTelemetry_TERMSIZE * 2];
+		termBuf[0] = '\0';
+		if(m_transmitTermNumber)
+			strcpy(termBuf, ",");
+		strncat(termBuf, _value, sizeof(termBuf) - strlen(termBuf) - 1);
+
+		for(const char *c = termBuf; *c; c++)
+			m_transmitChecksum ^= (int)(*c);
+
+		m_transmitTermNumber++;
+
+		m_commInterface->puts(termBuf);
+		m_commInterface->tick();
+	}
+
+	void sendTerm(int _value)
+	{
+		char numberBuf[CTelemetry_TERMSIZE + 1];
+		Old_ItoA(_value, numberBuf, 10);
+		sendTerm(numberBuf);
+	}
+
+	void sendTerm(double _value)
+	{
+		char numberBuf[CTelemetry_TERMSIZE + 1];
+		Old_DtoA(numberBuf, _value, 2);
+		sendTerm(numberBuf);
+	}
+
+	void transmissionEnd()
+	{
+		static const char *hexChars = "0123456789ABCDEF";
+
+		char termBuf[6];
+		termBuf[0] = '*';
+		termBuf[1] = hexChars[((m_transmitChecksum & 0xF0) >> 4)];
+		termBuf[2] = hexChars[(m_transmitChecksum & 0x0F)];
+		termBuf[3] = '\r';
+		termBuf[4] = '\n';
+		termBuf[5] = '\0';
+
+		m_commInterface->puts(termBuf);
+		m_commInterface->tick();
+	}
+};
+
+////////////////////////////////////////////////////////////
+// The sentences. Sun times and the position are what the
+// sketch sends most doubles for; door_info is mostly small
+// integers. The old path sent doubles with two places, so
+// the new one is asked for two here as well.
+////////////////////////////////////////////////////////////
+#define BENCH_SUN_SETS	(8)
+static const double s_sunValues[BENCH_SUN_SETS][4] =
+{
+	{ 11.25, 22.75, 12.5, 23.5 },
+	{ 6.5, 18.25, 7.0, 19.75 },
+	{ 0.0, 12.0, 0.5, 13.0 },
+	{ 23.75, 11.5, 0.25, 12.25 },
+	{ 40.25, -83.5, 1.5, -1.0 },
+	{ -33.75, 151.25, 10.0, 105.5 },
+	{ 9.0, 21.0, 8.75, 20.5 },
+	{ 5.25, 17.75, 6.0, 18.5 },
+};
+
+#define BENCH_INT_SETS	(4)
+static const int s_intValues[BENCH_INT_SETS][6] =
+{
+	{ 6, 0, 1, 1, 0, 30 },
+	{ 6, 1, 0, 0, 2, -15 },
+	{ 6, 2, 1, 0, 1, 120 },
+	{ 6, 3, 0, 1, 0, 9999 },
+};
+
+template<class T> static void sendSun(T &_telemetry, int _set)
+{
+	_telemetry.transmissionStart();
+	_telemetry.sendTerm(4);
+	for(int i = 0; i < 4; ++i)
+		_telemetry.sendTerm(s_sunValues[_set][i]);
+	_telemetry.transmissionEnd();
+}
+
+static void sendSun(CTelemetry &_telemetry, int _set)
+{
+	_telemetry.transmissionStart();
+	_telemetry.sendTerm(4);
+	for(int i = 0; i < 4; ++i)
+		_telemetry.sendTerm(s_sunValues[_set][i], 2);
+	_telemetry.transmissionEnd();
+}
+
+template<class T> static void sendInts(T &_telemetry, int _set)
+{
+	_telemetry.transmissionStart();
+	for(int i = 0; i < 6; ++i)
+		_telemetry.sendTerm(s_intValues[_set][i]);
+	_telemetry.transmissionEnd();
+}
+
+////////////////////////////////////////////////////////////
+// True if the two sentences have the same terms, to within
+// the second decimal place
+////////////////////////////////////////////////////////////
+static bool sameSentence(const char *_old, const char *_new)
+{
+	if((*_old++ != '$') || (*_new++ != '$'))
+		return false;
+
+	for(;;)
+	{
+		char *oldEnd;
+		char *newEnd;
+		double oldValue = strtod(_old, &oldEnd);
+		double newValue = strtod(_new, &newEnd);
+
+		if((oldEnd == _old) || (newEnd == _new) || (fabs(oldValue - newValue) > 0.0101))
+			return false;
+
+		if((*oldEnd != *newEnd) || ((*oldEnd != ',') && (*oldEnd != '*')))
+			return false;
+
+		if(*oldEnd == '*')
+			return true;
+
+		_old = oldEnd + 1;
+		_new = newEnd + 1;
+	}
+}
+
+////////////////////////////////////////////////////////////
+// Times _passes sentences through _send and returns the
+// nanoseconds per sentence
+////////////////////////////////////////////////////////////
+template<class T> static double timeSentences(T &_telemetry, void (*_send)(T &, int),
+		int _sets, long _passes)
+{
+	clock_t start = clock();
+	for(long pass = 0; pass < _passes; ++pass)
+		_send(_telemetry, (int)(pass % _sets));
+
+	return ((double)(clock() - start) / CLOCKS_PER_SEC) * 1e9 / _passes;
+}
+
+static void usage(const char *_name)
+{
+	fprintf(stderr, "usage: %s [-n sentences]\n", _name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	long passes = 2000000;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(!strcmp(argv[i], "-n") && ((i + 1) < argc))
+			passes = atol(argv[++i]);
+		else
+			usage(argv[0]);
+	}
+
+	if(passes <= 0)
+		usage(argv[0]);
+
+	CBenchPort oldPort;
+	COldTelemetry oldTelemetry(&oldPort);
+
+	CBenchPort newPort;
+	CTelemetry newTelemetry;
+	newTelemetry.setInterfaces(&newPort, 0);
+
+	// Both paths have to send the same values
+	int mismatches = 0;
+	for(int set = 0; set < (BENCH_SUN_SETS + BENCH_INT_SETS); ++set)
+	{
+		if(set < BENCH_SUN_SETS)
+		{
+			sendSun(oldTelemetry, set);
+			sendSun(newTelemetry, set);
+		}
+		else
+		{
+			sendInts(oldTelemetry, set - BENCH_SUN_SETS);
+			sendInts(newTelemetry, set - BENCH_SUN_SETS);
+		}
+
+		if(!sameSentence(oldPort.m_sentence, newPort.m_sentence))
+		{
+			fprintf(stderr, "mismatch:\n  old %s  new %s", oldPort.m_sentence, newPort.m_sentence);
+			mismatches++;
+		}
+	}
+
+	if(mismatches)
+		return 1;
+
+	double oldSun = timeSentences<COldTelemetry>(oldTelemetry, sendSun, BENCH_SUN_SETS, passes);
+	double newSun = timeSentences<CTelemetry>(newTelemetry, sendSun, BENCH_SUN_SETS, passes);
+	double oldInts = timeSentences<COldTelemetry>(oldTelemetry, sendInts, BENCH_INT_SETS, passes);
+	double newInts = timeSentences<CTelemetry>(newTelemetry, sendInts, BENCH_INT_SETS, passes);
+
+	printf("sentence    old ns   new ns  speedup\n");
+	printf("sun_times %8.0f %8.0f %7.1fx\n", oldSun, newSun, oldSun / newSun);
+	printf("door_info %8.0f %8.0f %7.1fx\n", oldInts, newInts, oldInts / newInts);
+
+	return 0;
+}
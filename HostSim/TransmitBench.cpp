@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////
+// Host benchmark - telemetry transmit path throughput
+////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+#include <Arduino.h>
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "../ICommInterface.h"
+#include "../TelemetryTags.h"
+#include "../Telemetry.h"
+#include "../MilliTimer.h"
+#include "../TelemetryScheduler.h"
+#include "../TaskScheduler.h"
+#include "../SlidingBuf.h"
+#include "../SPSCQueue.h"
+#include "../SerialPort.h"
+
+#include "../Pins.h"
+#include "../SunCalc.h"
+#include "../DoorController.h"
+#include "../LightController.h"
+#include "../BeepController.h"
+#include "../GaryCooper.h"
+
+#include "HostSim.h"
+
+////////////////////////////////////////////////////////////
+// Two measurements of the bulk telemetry lane:
+//
+// The wire run drives the sketch at more than the line rate
+// can carry, in virtual time, and counts the bytes that reach
+// the telemetry UART. The port should keep the line busy, so
+// this should be close to TELEMETRY_BAUD_RATE / 10.
+//
+// The buffer run moves the same traffic (sentence sized
+// writes, UART sized reads) through a CSerialPort sized
+// buffer, and through a copy of the old buffer that moved
+// everything left down to the front on every read. It prints
+// the bytes/s each can move on this host, and how many bytes
+// the old one shifted for every byte sent. The host's memmove
+// is very fast, so the shifting costs far more on the board
+// than the host numbers suggest.
+////////////////////////////////////////////////////////////
+
+// Above the tags the sketch sends, and above the tracked
+// tags, so delta mode never holds it back
+#define BENCH_TAG	(99)
+
+// 40 bytes or so, a typical bulk sentence
+static void sendBenchSentence(CTelemetry &_telemetry, unsigned long _count)
+{
+	_telemetry.transmissionStart();
+	_telemetry.sendTerm(BENCH_TAG);
+	_telemetry.sendTerm(_count);
+	_telemetry.sendTerm(12345L);
+	_telemetry.sendTerm(40.25);
+	_telemetry.sendTerm(-83.125);
+	_telemetry.sendTerm(true);
+	_telemetry.transmissionEnd();
+}
+
+////////////////////////////////////////////////////////////
+// The old buffer, as it was before the ring buffer
+////////////////////////////////////////////////////////////
+class COldSlidingBuffer
+{
+protected:
+	unsigned char m_buf[CSerialPort_TRANSMIT_BUFSIZE];
+	unsigned int m_dataLen;
+
+public:
+	unsigned long long m_shifted;	// Bytes moved down by consume()
+
+	COldSlidingBuffer()
+	{
+		m_dataLen = 0;
+		m_shifted = 0;
+	}
+
+	int bytesAvailable()
+	{
+		return m_dataLen;
+	}
+
+	void consume(unsigned int _consumeLen)
+	{
+		if(_consumeLen < 1)
+			return;
+
+		if(_consumeLen >= m_dataLen)
+		{
+			m_dataLen = 0;
+			return;
+		}
+
+		m_dataLen -= _consumeLen;
+		memmove(m_buf, m_buf + _consumeLen, m_dataLen);
+		m_shifted += m_dataLen;
+	}
+
+	unsigned int read(unsigned char *_buf, unsigned int _bufSize, bool _consume = true)
+	{
+		unsigned int amountToCopy = bytesAvailable();
+		if(amountToCopy > _bufSize)
+			amountToCopy = _bufSize;
+
+		if(amountToCopy <= 0)
+			return 0;
+
+		memmove(_buf, m_buf, amountToCopy);
+
+		if(_consume)
+			consume(amountToCopy);
+
+		return amountToCopy;
+	}
+
+	unsigned int write(const unsigned char *_buf, unsigned int _bufSize)
+	{
+		unsigned int freeSpace = sizeof(m_buf) - m_dataLen;
+		unsigned int lenToAdd = (freeSpace < _bufSize) ? freeSpace : _bufSize;
+
+		memmove(m_buf + m_dataLen, _buf, lenToAdd);
+		m_dataLen += lenToAdd;
+
+		return lenToAdd;
+	}
+};
+
+////////////////////////////////////////////////////////////
+// Keeps the buffer close to full and drains it a UART's
+// worth at a time, as the port does when the line is busy.
+// Returns the bytes moved per second of host time.
+////////////////////////////////////////////////////////////
+template<class T> static double bufferThroughput(T &_buffer, unsigned long long _bytes)
+{
+	static const char sentence[] = "$99,1234,12345,40.25,-83.125,1*5A\r\n";
+	const unsigned int sentenceLen = sizeof(sentence) - 1;
+	unsigned char chunk[CSerialPort_CHUNKSIZE];
+	unsigned long long moved = 0;
+	unsigned long checksum = 0;
+
+	clock_t start = clock();
+	while(moved < _bytes)
+	{
+		while((CSerialPort_TRANSMIT_BUFSIZE - (unsigned int)_buffer.bytesAvailable()) >= sentenceLen)
+			_buffer.write((const unsigned char *)sentence, sentenceLen);
+
+		unsigned int count = _buffer.read(chunk, CSerialPort_CHUNKSIZE - 1);
+		checksum += chunk[count - 1];
+		moved += count;
+	}
+	double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	// Keep the reads from being optimized away
+	if(checksum == 1)
+		printf(" ");
+
+	return moved / seconds;
+}
+
+static void usage(const char *_name)
+{
+	fprintf(stderr, "usage: %s [-s virtual seconds] [-m megabytes]\n", _name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long seconds = 60;
+	unsigned long megabytes = 500;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(!strcmp(argv[i], "-s") && ((i + 1) < argc))
+			seconds = strtoul(argv[++i], 0, 10);
+		else if(!strcmp(argv[i], "-m") && ((i + 1) < argc))
+			megabytes = strtoul(argv[++i], 0, 10);
+		else
+			usage(argv[0]);
+	}
+
+	if(!seconds || !megabytes)
+		usage(argv[0]);
+
+	double lineRate = TELEMETRY_BAUD_RATE / 10.;	// 8N1
+
+	// The wire run. Offer twice what the line can carry.
+	setup();
+
+	unsigned long long endUS = seconds * 1000000ULL;
+	unsigned long long wireBytes = 0;
+	unsigned long offered = 0;
+	unsigned long sentences = 0;
+
+	clock_t start = clock();
+	while(g_hostSim.getElapsedUS() < endUS)
+	{
+		if(offered < (2. * lineRate * g_hostSim.getElapsedUS() / 1e6))
+		{
+			sendBenchSentence(g_telemetry, sentences++);
+			offered += 40;
+		}
+
+		g_hostSim.loopPass();
+		wireBytes += TELEMETRY_SERIAL.simTakeTransmitted().size();
+		DEBUG_SERIAL.simTakeTransmitted();
+	}
+	double hostSeconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("wire:   %.0f bytes/s at %ld baud, %.1f%% of the line, %lu sentences pushed out\n",
+		   wireBytes / (endUS / 1e6), (long)TELEMETRY_BAUD_RATE,
+		   100. * (wireBytes / (endUS / 1e6)) / lineRate, g_telemetry.getEvictedSentences());
+	printf("        %.0f virtual seconds in %.2f host seconds\n", endUS / 1e6, hostSeconds);
+
+	// The buffer run
+	unsigned long long bytes = megabytes * 1000000ULL;
+
+	COldSlidingBuffer oldBuffer;
+	double oldRate = bufferThroughput(oldBuffer, bytes);
+
+	CStaticSlidingBuffer<CSerialPort_TRANSMIT_BUFSIZE> newBuffer;
+	double newRate = bufferThroughput(newBuffer, bytes);
+
+	printf("buffer: old %.0f MB/s, %.1f bytes shifted per byte sent\n",
+		   oldRate / 1e6, (double)oldBuffer.m_shifted / bytes);
+	printf("        new %.0f MB/s, nothing shifted\n", newRate / 1e6);
+
+	return 0;
+}
@@ -0,0 +1,18 @@
+////////////////////////////////////////////////////////////
+// Host simulation - sleep shim
+////////////////////////////////////////////////////////////
+#ifndef sleep_h
+#define sleep_h
+
+////////////////////////////////////////////////////////////
+// sleep_cpu() skips virtual time ahead to the next timer 0
+// interrupt, as idle sleep would on the board.
+////////////////////////////////////////////////////////////
+#define SLEEP_MODE_IDLE	(0)
+
+void set_sleep_mode(uint8_t _mode);
+void sleep_enable();
+void sleep_disable();
+void sleep_cpu();
+
+#endif
@@ -4,6 +4,16 @@
 #ifndef ICCOMMUNICATIONINTERFACE_H
 #define ICCOMMUNICATIONINTERFACE_H
 
+////////////////////////////////////////////////////////////
+// Takes received data as it arrives, in place. The data is
+// only valid during the call.
+////////////////////////////////////////////////////////////
+class ICommunicationSink
+{
+public:
+	virtual void receive(const unsigned char *_buf, unsigned int _bufLen) = 0;
+};
+
 ////////////////////////////////////////////////////////////
 // More Description and notes
 ////////////////////////////////////////////////////////////
@@ -12,10 +22,25 @@ class ICommunicationInterface
 public:
 	virtual unsigned int read(unsigned char *_pBuf, unsigned int _iBufSize, bool _bConsume = true) = 0;
 	virtual unsigned int write(const unsigned char *_pBuf, unsigned int _iBufSize) = 0;
+
+	// Urgent data is sent ahead of anything written with write(),
+	// but only between records so the two are never interleaved
+	virtual unsigned int writeUrgent(const unsigned char *_pBuf, unsigned int _iBufSize) = 0;
+	virtual void setTransmitDelimiter(unsigned char _delimiter) = 0;
 	virtual int getError() = 0;
 
 	virtual int bytesInReceiveBuffer() = 0;
 	virtual int bytesInTransmitBuffer() = 0;
+	virtual unsigned int bytesFreeInTransmitBuffer() = 0;
+	virtual unsigned int bytesFreeInUrgentTransmitBuffer() = 0;
+
+	// Drop whole records (ending with _delimiter) that are waiting
+	// to be sent, oldest first. Returns the number dropped.
+	virtual unsigned int discardTransmitRecords(unsigned int _minLen, unsigned char _delimiter) = 0;
+
+	// With a sink attached, received data goes to it instead
+	// of the receive buffer. Zero detaches it.
+	virtual void setReceiveSink(ICommunicationSink *_sink) = 0;
 
 	virtual int gets(char *_pBuf, int _iBufLen) = 0;
 	virtual bool puts(const char * _pBuf) = 0;
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////
+// Idle Sleep
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "ICommInterface.h"
+#include "TelemetryTags.h"
+#include "Telemetry.h"
+#include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
+
+#include "Pins.h"
+#include "SunCalc.h"
+#include "DoorController.h"
+#include "LightController.h"
+#include "BeepController.h"
+#include "GaryCooper.h"
+
+#include "IdleSleep.h"
+
+#ifdef GARY_COOPER_IDLE_SLEEP
+
+CIdleSleep g_idleSleep;
+
+CIdleSleep::CIdleSleep()
+{
+	m_windowStartMS = 0;
+	m_asleepUS = 0;
+	m_sleeps = 0;
+}
+
+CIdleSleep::~CIdleSleep()
+{
+}
+
+void CIdleSleep::sleep()
+{
+	uint32_t startUS = micros();
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+
+	// The instruction after sei always runs before any interrupt,
+	// so one that is already pending can't slip in between and
+	// leave us asleep with work to do
+	interrupts();
+	sleep_cpu();
+	sleep_disable();
+
+	m_asleepUS += micros() - startUS;
+	m_sleeps++;
+}
+
+unsigned int CIdleSleep::getAwakePerMille()
+{
+	unsigned long windowMS = millis() - m_windowStartMS;
+	unsigned long asleepMS = m_asleepUS / 1000UL;
+
+	if(!windowMS || (asleepMS >= windowMS))
+		return windowMS ? 0 : 1000;
+
+	return 1000 - (unsigned int)((asleepMS * 1000UL) / windowMS);
+}
+
+void CIdleSleep::sendTelemetry()
+{
+	g_telemetry.transmissionStart();
+	g_telemetry.sendTerm(telemetry_tag_duty_cycle);
+	g_telemetry.sendTerm(getAwakePerMille());
+	g_telemetry.sendTerm((unsigned long)(millis() - m_windowStartMS));
+	g_telemetry.sendTerm(m_asleepUS / 1000UL);
+	g_telemetry.sendTerm(m_sleeps);
+	g_telemetry.transmissionEnd();
+
+	m_windowStartMS = millis();
+	m_asleepUS = 0;
+	m_sleeps = 0;
+}
+
+#endif // GARY_COOPER_IDLE_SLEEP
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////
+// Idle Sleep
+////////////////////////////////////////////////////////////
+#ifndef IdleSleep_h
+#define IdleSleep_h
+
+////////////////////////////////////////////////////////////
+// Puts the MCU in idle sleep when loop() has nothing to do.
+// Idle mode leaves the timers and UARTs running, so any
+// interrupt wakes it: received data, the timer 0 tick that
+// runs millis() and polls the UARTs, or a pin change. It
+// keeps track of the time spent asleep and sends the duty
+// cycle as telemetry_tag_duty_cycle.
+//
+// Define GARY_COOPER_IDLE_SLEEP in GaryCooper.h to turn it
+// on. Include after GaryCooper.h.
+////////////////////////////////////////////////////////////
+#ifdef GARY_COOPER_IDLE_SLEEP
+
+class CIdleSleep
+{
+protected:
+	// Since the last report
+	uint32_t m_windowStartMS;
+	unsigned long m_asleepUS;
+	unsigned long m_sleeps;
+
+public:
+	CIdleSleep();
+	virtual ~CIdleSleep();
+
+	// Call with interrupts off, after checking there is
+	// nothing to do. Returns after the next interrupt, with
+	// interrupts on.
+	void sleep();
+
+	// Awake, out of 1000, since the last report
+	unsigned int getAwakePerMille();
+
+	// Sends the duty cycle and starts a new window
+	void sendTelemetry();
+};
+
+extern CIdleSleep g_idleSleep;
+
+#endif // GARY_COOPER_IDLE_SLEEP
+
+#endif
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////
+// Input Capture
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "ICommInterface.h"
+#include "TelemetryTags.h"
+#include "Telemetry.h"
+#include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
+
+#include "Pins.h"
+#include "SunCalc.h"
+#include "DoorController.h"
+#include "LightController.h"
+#include "BeepController.h"
+#include "GaryCooper.h"
+
+#include "InputCapture.h"
+
+#ifdef GARY_COOPER_INPUT_CAPTURE
+
+CInputCapture g_inputCapture;
+
+static void putInt16(unsigned char *_buf, int _value)
+{
+	_buf[0] = _value & 0xFF;
+	_buf[1] = (_value >> 8) & 0xFF;
+}
+
+static void putFloat(unsigned char *_buf, double _value)
+{
+	// The AVR's doubles are floats anyway
+	float value = _value;
+	memcpy(_buf, &value, sizeof(value));
+}
+
+CInputCapture::CInputCapture()
+{
+	m_open = false;
+	m_lastSwitches = 0xFFFF;
+
+	m_stream = inputCapture_setup;
+	m_bufLen = 0;
+}
+
+CInputCapture::~CInputCapture()
+{
+}
+
+void CInputCapture::open()
+{
+	const unsigned char header[] = { 'G', 'C', 'T', 'R', CInputCapture_VERSION };
+
+	CAPTURE_SERIAL.begin(CAPTURE_BAUD_RATE);
+	CAPTURE_SERIAL.write(header, sizeof(header));
+	m_open = true;
+}
+
+void CInputCapture::writeRecord(inputCaptureStreamE _stream, const unsigned char *_data, unsigned char _len)
+{
+	uint32_t now = millis();
+	unsigned char header[6];
+
+	header[0] = _stream;
+	header[1] = now & 0xFF;
+	header[2] = (now >> 8) & 0xFF;
+	header[3] = (now >> 16) & 0xFF;
+	header[4] = (now >> 24) & 0xFF;
+	header[5] = _len;
+
+	CAPTURE_SERIAL.write(header, sizeof(header));
+	if(_len)
+		CAPTURE_SERIAL.write(_data, _len);
+}
+
+void CInputCapture::flush()
+{
+	if(!m_bufLen)
+		return;
+
+	writeRecord(m_stream, m_buf, m_bufLen);
+	m_bufLen = 0;
+}
+
+void CInputCapture::record(inputCaptureStreamE _stream, const unsigned char *_data, unsigned int _len)
+{
+	if(!m_open)
+		return;
+
+	// Keep the streams in order
+	if(_stream != m_stream)
+		flush();
+	m_stream = _stream;
+
+	// Markers have no data
+	if(!_len)
+	{
+		writeRecord(_stream, 0, 0);
+		return;
+	}
+
+	while(_len)
+	{
+		unsigned char chunk = CInputCapture_BUFSIZE - m_bufLen;
+		if(chunk > _len)
+			chunk = _len;
+
+		memcpy(m_buf + m_bufLen, _data, chunk);
+		m_bufLen += chunk;
+		_data += chunk;
+		_len -= chunk;
+
+		if(m_bufLen == CInputCapture_BUFSIZE)
+			flush();
+	}
+}
+
+void CInputCapture::recordSettings()
+{
+	unsigned char settings[CInputCapture_SETTINGS_LEN];
+
+	putInt16(settings + 0, g_doorController.getSunriseOffset());
+	putInt16(settings + 2, g_doorController.getSunsetOffset());
+	putInt16(settings + 4, g_doorController.getStuckDoorDelay());
+	putFloat(settings + 6, g_lightController.getMinimumDayLength());
+	putFloat(settings + 10, g_lightController.getExtraLightTimeMorning());
+	putFloat(settings + 14, g_lightController.getExtraLightTimeEvening());
+
+	record(inputCapture_settings, settings, sizeof(settings));
+	flush();
+}
+
+void CInputCapture::recordSwitches(unsigned int _switches)
+{
+	if(_switches == m_lastSwitches)
+		return;
+
+	unsigned char switches = _switches;
+	record(inputCapture_doorSwitches, &switches, sizeof(switches));
+	flush();
+	m_lastSwitches = _switches;
+}
+
+#endif // GARY_COOPER_INPUT_CAPTURE
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////
+// Input Capture
+////////////////////////////////////////////////////////////
+#ifndef InputCapture_h
+#define InputCapture_h
+
+////////////////////////////////////////////////////////////
+// Logs the controller's inputs, stamped with millis(), to
+// CAPTURE_SERIAL so a field problem can be replayed on a PC
+// (see HostSim/ReplaySim.cpp). The trace is binary:
+//
+//   Header:	'G' 'C' 'T' 'R' version
+//   Record:	stream, millis() (4 bytes), length, data
+//
+// Multi-byte values are little endian. Chunks of the same
+// stream are gathered into one record until something else
+// is recorded, the buffer fills, or flush() is called, which
+// timeCheckTask() does before it looks at the GPS data. A
+// record is stamped when it is written.
+//
+// Define GARY_COOPER_INPUT_CAPTURE in GaryCooper.h to turn
+// it on. Otherwise the macros are empty and none of this
+// is compiled. Include after GaryCooper.h.
+////////////////////////////////////////////////////////////
+#define CInputCapture_VERSION	(1)
+
+// What a record holds
+typedef enum
+{
+	inputCapture_setup = 0,		// End of setup(), no data
+	inputCapture_settings,		// Settings after loading, see below
+	inputCapture_GPS,			// As passed to the GPS parser
+	inputCapture_telemetry,		// As passed to the telemetry parser
+	inputCapture_doorSwitches,	// New switch mask (open 1, closed 2)
+} inputCaptureStreamE;
+
+// Settings record: sunrise offset, sunset offset, stuck door
+// delay (2 bytes each), minimum day length, morning and
+// evening extra light (4 byte floats)
+#define CInputCapture_SETTINGS_LEN	(18)
+
+#ifdef GARY_COOPER_INPUT_CAPTURE
+
+#define CInputCapture_BUFSIZE	(64)
+
+class CInputCapture
+{
+protected:
+	bool m_open;
+	unsigned int m_lastSwitches;
+
+	// Waiting to be written
+	inputCaptureStreamE m_stream;
+	unsigned char m_buf[CInputCapture_BUFSIZE];
+	unsigned char m_bufLen;
+
+	void writeRecord(inputCaptureStreamE _stream, const unsigned char *_data, unsigned char _len);
+
+public:
+	CInputCapture();
+	virtual ~CInputCapture();
+
+	void open();
+	void flush();
+
+	void record(inputCaptureStreamE _stream, const unsigned char *_data, unsigned int _len);
+	void recordSettings();
+
+	// Only changes are recorded
+	void recordSwitches(unsigned int _switches);
+};
+
+extern CInputCapture g_inputCapture;
+
+// Records what it receives, then passes it on
+class CInputCaptureSink : public ICommunicationSink
+{
+protected:
+	inputCaptureStreamE m_stream;
+	ICommunicationSink *m_sink;
+
+public:
+	CInputCaptureSink(inputCaptureStreamE _stream, ICommunicationSink *_sink)
+	{
+		m_stream = _stream;
+		m_sink = _sink;
+	}
+
+	void receive(const unsigned char *_buf, unsigned int _bufLen)
+	{
+		// Commands act at once, so don't hold them back
+		g_inputCapture.record(m_stream, _buf, _bufLen);
+		g_inputCapture.flush();
+		m_sink->receive(_buf, _bufLen);
+	}
+};
+
+#define INPUT_CAPTURE_OPEN()					g_inputCapture.open()
+#define INPUT_CAPTURE_FLUSH()					g_inputCapture.flush()
+#define INPUT_CAPTURE(_stream, _data, _len)		g_inputCapture.record(_stream, _data, _len)
+#define INPUT_CAPTURE_SETTINGS()				g_inputCapture.recordSettings()
+#define INPUT_CAPTURE_SWITCHES(_switches)		g_inputCapture.recordSwitches(_switches)
+
+#else
+
+#define INPUT_CAPTURE_OPEN()
+#define INPUT_CAPTURE_FLUSH()
+#define INPUT_CAPTURE(_stream, _data, _len)
+#define INPUT_CAPTURE_SETTINGS()
+#define INPUT_CAPTURE_SWITCHES(_switches)
+
+#endif // GARY_COOPER_INPUT_CAPTURE
+
+#endif
@@ -10,6 +10,8 @@
 #include "Telemetry.h"
 #include "TelemetryTags.h"
 #include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
 
 #include "Pins.h"
 #include "SunCalc.h"
@@ -204,16 +206,18 @@ void CLightController::checkTime()
 #endif
 }
 
-void CLightController::sendTelemetry()
+void CLightController::sendConfigTelemetry()
 {
-	// Telemetry
 	g_telemetry.transmissionStart();
 	g_telemetry.sendTerm(telemetry_tag_light_config);
 	g_telemetry.sendTerm(getMinimumDayLength());
 	g_telemetry.sendTerm(getExtraLightTimeMorning());
 	g_telemetry.sendTerm(getExtraLightTimeEvening());
 	g_telemetry.transmissionEnd();
+}
 
+void CLightController::sendInfoTelemetry()
+{
 	g_telemetry.transmissionStart();
 	g_telemetry.sendTerm(telemetry_tag_light_info);
 	g_telemetry.sendTerm(m_morningLightOnTime);
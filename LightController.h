@@ -100,7 +100,9 @@ public:
 	void loadSettings(CSaveController &_saveController);
 
 	void checkTime();
-	void sendTelemetry();
+
+	void sendConfigTelemetry();
+	void sendInfoTelemetry();
 
 	telemetrycommandResponseE command(bool _on);
 };
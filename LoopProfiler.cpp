@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////
+// Loop Profiler
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "ICommInterface.h"
+#include "TelemetryTags.h"
+#include "Telemetry.h"
+#include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
+
+#include "Pins.h"
+#include "SunCalc.h"
+#include "DoorController.h"
+#include "LightController.h"
+#include "BeepController.h"
+#include "GaryCooper.h"
+
+#include "LoopProfiler.h"
+
+#ifdef GARY_COOPER_LOOP_PROFILER
+
+CLoopProfiler g_loopProfiler;
+
+CLoopProfiler::CLoopProfiler()
+{
+	for(int section = 0; section < loopProfile_count; ++section)
+		clear(section);
+
+	m_sendSection = 0;
+}
+
+CLoopProfiler::~CLoopProfiler()
+{
+}
+
+void CLoopProfiler::clear(int _section)
+{
+	CLoopProfiler_SectionS &section = m_sections[_section];
+
+	section.m_count = 0;
+	section.m_minUS = 0xFFFFFFFFUL;
+	section.m_maxUS = 0;
+	section.m_totalUS = 0;
+
+	for(int bucket = 0; bucket < CLoopProfiler_BUCKETS; ++bucket)
+		section.m_buckets[bucket] = 0;
+}
+
+void CLoopProfiler::record(loopProfileSectionE _section, unsigned long _elapsedUS)
+{
+	CLoopProfiler_SectionS &section = m_sections[_section];
+
+	section.m_count++;
+	section.m_totalUS += _elapsedUS;
+
+	if(_elapsedUS < section.m_minUS)
+		section.m_minUS = _elapsedUS;
+
+	if(_elapsedUS > section.m_maxUS)
+		section.m_maxUS = _elapsedUS;
+
+	int bucket = 0;
+	unsigned long limit = CLoopProfiler_BUCKET_BASE_US;
+	while((bucket < (CLoopProfiler_BUCKETS - 1)) && (_elapsedUS >= limit))
+	{
+		limit <<= 1;
+		++bucket;
+	}
+
+	// Saturate rather than wrap
+	if(section.m_buckets[bucket] != 0xFFFF)
+		section.m_buckets[bucket]++;
+}
+
+void CLoopProfiler::sendTelemetry()
+{
+	CLoopProfiler_SectionS &section = m_sections[m_sendSection];
+
+	g_telemetry.transmissionStart();
+	g_telemetry.sendTerm(telemetry_tag_loop_profile);
+	g_telemetry.sendTerm(m_sendSection);
+	g_telemetry.sendTerm(section.m_count);
+	g_telemetry.sendTerm(section.m_count ? section.m_minUS : 0UL);
+	g_telemetry.sendTerm(section.m_maxUS);
+	g_telemetry.sendTerm(section.m_count ? (section.m_totalUS / section.m_count) : 0UL);
+	for(int bucket = 0; bucket < CLoopProfiler_BUCKETS; ++bucket)
+		g_telemetry.sendTerm(section.m_buckets[bucket]);
+	g_telemetry.transmissionEnd();
+
+	clear(m_sendSection);
+
+	if(++m_sendSection >= loopProfile_count)
+		m_sendSection = 0;
+}
+
+#endif // GARY_COOPER_LOOP_PROFILER
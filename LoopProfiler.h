@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////
+// Loop Profiler
+////////////////////////////////////////////////////////////
+#ifndef LoopProfiler_h
+#define LoopProfiler_h
+
+////////////////////////////////////////////////////////////
+// Times sections of loop() with micros(). Each section keeps
+// a count, min, max, mean and a histogram with power of two
+// bucket widths. The stats go out as
+// telemetry_tag_loop_profile, one section per sentence,
+// and are cleared when they have been sent.
+//
+// Define GARY_COOPER_LOOP_PROFILER in GaryCooper.h to turn
+// it on. Otherwise the macros are empty and none of this
+// is compiled. Include after GaryCooper.h.
+////////////////////////////////////////////////////////////
+#ifdef GARY_COOPER_LOOP_PROFILER
+
+// Bucket n counts times under (64 << n) microseconds, the
+// last one everything longer
+#define CLoopProfiler_BUCKETS			(10)
+#define CLoopProfiler_BUCKET_BASE_US	(64UL)
+
+// Sections of loop()
+typedef enum
+{
+	loopProfile_loop = 0,			// All of it
+	loopProfile_GPS,				// Reading and parsing GPS data
+	loopProfile_telemetryComm,		// Telemetry port and command parsing
+	loopProfile_tasks,				// Everything the task scheduler runs
+	loopProfile_door,				// Door controller tick (switch debouncing)
+	loopProfile_telemetrySend,		// Scheduled telemetry
+
+	loopProfile_count
+} loopProfileSectionE;
+
+class CLoopProfiler
+{
+protected:
+	typedef struct
+	{
+		unsigned long m_count;
+		unsigned long m_minUS;
+		unsigned long m_maxUS;
+		unsigned long m_totalUS;
+		unsigned int m_buckets[CLoopProfiler_BUCKETS];
+	} CLoopProfiler_SectionS;
+
+	CLoopProfiler_SectionS m_sections[loopProfile_count];
+
+	// Next section to send
+	int m_sendSection;
+
+	void clear(int _section);
+
+public:
+	CLoopProfiler();
+	virtual ~CLoopProfiler();
+
+	void record(loopProfileSectionE _section, unsigned long _elapsedUS);
+
+	// Sends the next section, so a full report takes
+	// loopProfile_count calls
+	void sendTelemetry();
+};
+
+extern CLoopProfiler g_loopProfiler;
+
+#define LOOP_PROFILE_BEGIN(_section)	uint32_t _section##_startUS = micros()
+#define LOOP_PROFILE_END(_section)		g_loopProfiler.record(_section, micros() - _section##_startUS)
+
+#else
+
+#define LOOP_PROFILE_BEGIN(_section)
+#define LOOP_PROFILE_END(_section)
+
+#endif // GARY_COOPER_LOOP_PROFILER
+
+#endif
@@ -17,7 +17,7 @@ public:
 
 protected:
 	unsigned long m_interval;
-	unsigned long m_startingMillis;
+	uint32_t m_startingMillis;
 
 	CMilliTimerStateE m_state;
 
@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////
+// NMEA Filter
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+
+#include <GPSParser.h>
+#include <SaveController.h>
+
+#include "ICommInterface.h"
+#include "TelemetryTags.h"
+#include "Telemetry.h"
+#include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
+
+#include "Pins.h"
+#include "SunCalc.h"
+#include "DoorController.h"
+#include "LightController.h"
+#include "BeepController.h"
+#include "GaryCooper.h"
+
+#include "NMEAFilter.h"
+
+CNMEAFilter::CNMEAFilter(CGPSParser &_parser) :
+	m_parser(_parser)
+{
+	m_proprietarySink = 0;
+	m_state = nmeaFilter_idle;
+	m_addressLen = 0;
+
+	for(int type = 0; type < nmeaSentence_count; ++type)
+		m_sentences[type] = 0;
+	m_bytesDropped = 0;
+}
+
+CNMEAFilter::~CNMEAFilter()
+{
+}
+
+nmeaSentenceE CNMEAFilter::getSentenceType()
+{
+	// Proprietary sentences have no talker
+	if(m_address[1] == 'P')
+		return nmeaSentence_other;
+
+	const unsigned char *type = m_address + 3;
+	switch(type[0])
+	{
+	case 'R':
+		if((type[1] == 'M') && (type[2] == 'C'))
+			return nmeaSentence_RMC;
+		break;
+
+	case 'G':
+		if((type[1] == 'G') && (type[2] == 'A'))
+			return nmeaSentence_GGA;
+		if((type[1] == 'S') && (type[2] == 'A'))
+			return nmeaSentence_GSA;
+		if((type[1] == 'S') && (type[2] == 'V'))
+			return nmeaSentence_GSV;
+		if((type[1] == 'L') && (type[2] == 'L'))
+			return nmeaSentence_GLL;
+		break;
+
+	case 'V':
+		if((type[1] == 'T') && (type[2] == 'G'))
+			return nmeaSentence_VTG;
+		break;
+
+	default:
+		break;
+	}
+
+	return nmeaSentence_other;
+}
+
+void CNMEAFilter::pass(unsigned char *_data, unsigned int _dataLen)
+{
+	if(m_state == nmeaFilter_passToSink)
+		m_proprietarySink->receive(_data, _dataLen);
+	else
+		m_parser.parse(_data, _dataLen);
+}
+
+void CNMEAFilter::parse(unsigned char *_data, unsigned int _dataLen)
+{
+	// Wanted bytes are passed on in runs, not one at a time
+	unsigned int runStart = 0;
+	bool inRun = (m_state == nmeaFilter_pass) || (m_state == nmeaFilter_passToSink);
+
+	for(unsigned int index = 0; index < _dataLen; ++index)
+	{
+		unsigned char c = _data[index];
+
+		// A new sentence, even if the last one was cut short
+		if(c == '$')
+		{
+			if(inRun && (index > runStart))
+				pass(_data + runStart, index - runStart);
+			inRun = false;
+
+			if(m_state == nmeaFilter_address)
+				m_bytesDropped += m_addressLen;
+
+			m_address[0] = c;
+			m_addressLen = 1;
+			m_state = nmeaFilter_address;
+			continue;
+		}
+
+		switch(m_state)
+		{
+		case nmeaFilter_pass:
+		case nmeaFilter_passToSink:
+			if(c == '\n')
+			{
+				pass(_data + runStart, index + 1 - runStart);
+				inRun = false;
+				m_state = nmeaFilter_idle;
+			}
+			break;
+
+		case nmeaFilter_address:
+			// Too short to be a sentence
+			if((c == '\r') || (c == '\n'))
+			{
+				m_bytesDropped += m_addressLen + 1;
+				m_state = nmeaFilter_idle;
+				break;
+			}
+
+			m_address[m_addressLen++] = c;
+			if(m_addressLen == CNMEAFilter_ADDRESS_LEN)
+			{
+				nmeaSentenceE type = getSentenceType();
+				m_sentences[type]++;
+
+				if(isWanted(type) || ((m_address[1] == 'P') && m_proprietarySink))
+				{
+					m_state = isWanted(type) ? nmeaFilter_pass : nmeaFilter_passToSink;
+					pass(m_address, CNMEAFilter_ADDRESS_LEN);
+					runStart = index + 1;
+					inRun = true;
+				}
+				else
+				{
+					m_bytesDropped += CNMEAFilter_ADDRESS_LEN;
+					m_state = nmeaFilter_drop;
+				}
+			}
+			break;
+
+		case nmeaFilter_drop:
+			m_bytesDropped++;
+			if(c == '\n')
+				m_state = nmeaFilter_idle;
+			break;
+
+		case nmeaFilter_idle:
+		default:
+			m_bytesDropped++;
+			break;
+		}
+	}
+
+	if(inRun && (_dataLen > runStart))
+		pass(_data + runStart, _dataLen - runStart);
+}
+
+void CNMEAFilter::sendTelemetry()
+{
+	g_telemetry.transmissionStart();
+	g_telemetry.sendTerm(telemetry_tag_nmea_stats);
+	for(int type = 0; type < nmeaSentence_count; ++type)
+		g_telemetry.sendTerm(m_sentences[type]);
+	g_telemetry.sendTerm(m_bytesDropped);
+	g_telemetry.transmissionEnd();
+}
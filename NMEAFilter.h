@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////
+// NMEA Filter
+////////////////////////////////////////////////////////////
+#ifndef NMEAFilter_h
+#define NMEAFilter_h
+
+////////////////////////////////////////////////////////////
+// Sits in front of the GPS parser and only passes it the
+// sentences we use: RMC (lock, position, date and time) and
+// GGA (satellites). The type is read from the address field
+// ($ttsss) and the rest of an unwanted sentence is dropped
+// as it arrives, without being tokenized. A chatty receiver
+// also sends GSA, GSV, VTG and GLL, several times the bytes
+// of the sentences we keep.
+//
+// Proprietary sentences ($P...), such as a receiver's
+// replies to configuration commands, go to a sink if one
+// is set.
+//
+// Sentences are counted by type and sent as
+// telemetry_tag_nmea_stats. Include after GaryCooper.h.
+////////////////////////////////////////////////////////////
+
+// '$', talker (2), sentence type (3)
+#define CNMEAFilter_ADDRESS_LEN	(6)
+
+typedef enum
+{
+	nmeaSentence_RMC = 0,
+	nmeaSentence_GGA,
+	nmeaSentence_GSA,
+	nmeaSentence_GSV,
+	nmeaSentence_VTG,
+	nmeaSentence_GLL,
+	nmeaSentence_other,		// Including proprietary ($P...)
+
+	nmeaSentence_count
+} nmeaSentenceE;
+
+typedef enum
+{
+	nmeaFilter_idle = 0,	// Waiting for a '$'
+	nmeaFilter_address,		// Reading the address field
+	nmeaFilter_pass,		// Passing to the parser
+	nmeaFilter_passToSink,	// Passing to the proprietary sink
+	nmeaFilter_drop,		// Dropping to the end of the line
+} nmeaFilterStateE;
+
+class CNMEAFilter
+{
+protected:
+	CGPSParser &m_parser;
+	ICommunicationSink *m_proprietarySink;
+
+	nmeaFilterStateE m_state;
+	unsigned char m_address[CNMEAFilter_ADDRESS_LEN];
+	unsigned char m_addressLen;
+
+	// Since startup
+	unsigned long m_sentences[nmeaSentence_count];
+	unsigned long m_bytesDropped;
+
+	nmeaSentenceE getSentenceType();
+	void pass(unsigned char *_data, unsigned int _dataLen);
+	bool isWanted(nmeaSentenceE _type)
+	{
+		return (_type == nmeaSentence_RMC) || (_type == nmeaSentence_GGA);
+	}
+
+public:
+	CNMEAFilter(CGPSParser &_parser);
+	virtual ~CNMEAFilter();
+
+	void setProprietarySink(ICommunicationSink *_sink)
+	{
+		m_proprietarySink = _sink;
+	}
+
+	void parse(unsigned char *_data, unsigned int _dataLen);
+
+	unsigned long getSentences(nmeaSentenceE _type)
+	{
+		return m_sentences[_type];
+	}
+	unsigned long getBytesDropped()
+	{
+		return m_bytesDropped;
+	}
+
+	void sendTelemetry();
+};
+
+#endif
@@ -25,10 +25,17 @@
 #define DEBUG_BAUD_RATE	(9600)
 
 // Telemetry serial port
-#define TELEMETRY_PORT			(1)
+#define TELEMETRY_SERIAL		Serial1
 
 // GPS serial port
 #define GPS_SERIAL  	Serial2
 #define GPS_BAUD_RATE 	(9600)
 
+// Switch the GPS to this once it is up (GARY_COOPER_GPS_CONFIG)
+//#define GPS_FAST_BAUD_RATE	(38400)
+
+// Input capture serial port (GARY_COOPER_INPUT_CAPTURE)
+#define CAPTURE_SERIAL		Serial3
+#define CAPTURE_BAUD_RATE	(115200)
+
 #endif
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////
+// Single producer / single consumer byte queue
+////////////////////////////////////////////////////////////
+#ifndef SPSCQueue_h
+#define SPSCQueue_h
+
+////////////////////////////////////////////////////////////
+// A lock-free byte FIFO for handing data from an interrupt
+// to loop(). Exactly one side may push() (the producer,
+// usually an ISR) and exactly one side may pop() / read()
+// (the consumer). Each side only writes its own index, and
+// the indexes are single bytes so they are read and written
+// atomically on the AVR. Bytes that arrive while the queue
+// is full are dropped and counted.
+////////////////////////////////////////////////////////////
+
+// Keeps the compiler from moving buffer accesses across
+// index updates
+#define CSPSCQueue_BARRIER()	__asm__ __volatile__("" ::: "memory")
+
+template <unsigned int _capacity>
+class CSPSCQueue
+{
+	static_assert((_capacity >= 2) && (_capacity <= 256) && !(_capacity & (_capacity - 1)),
+				  "CSPSCQueue capacity must be a power of two from 2 to 256");
+
+protected:
+	unsigned char m_buf[_capacity];
+
+	volatile unsigned char m_head;		// Next to write, producer only
+	volatile unsigned char m_tail;		// Next to read, consumer only
+
+	volatile unsigned int m_overruns;	// Producer only
+
+public:
+	CSPSCQueue()
+	{
+		m_head = 0;
+		m_tail = 0;
+		m_overruns = 0;
+	}
+
+	// Producer side. Holds _capacity - 1 bytes.
+	bool push(unsigned char _c)
+	{
+		unsigned char head = m_head;
+		unsigned char next = (head + 1) & (_capacity - 1);
+
+		if(next == m_tail)
+		{
+			m_overruns++;
+			return false;
+		}
+
+		m_buf[head] = _c;
+		CSPSCQueue_BARRIER();
+		m_head = next;
+		return true;
+	}
+
+	// Consumer side
+	bool pop(unsigned char &_c)
+	{
+		unsigned char tail = m_tail;
+
+		if(tail == m_head)
+			return false;
+
+		_c = m_buf[tail];
+		CSPSCQueue_BARRIER();
+		m_tail = (tail + 1) & (_capacity - 1);
+		return true;
+	}
+
+	unsigned int read(unsigned char *_buf, unsigned int _bufSize)
+	{
+		unsigned char tail = m_tail;
+		unsigned char head = m_head;
+		unsigned int count = 0;
+
+		CSPSCQueue_BARRIER();
+		while((tail != head) && (count < _bufSize))
+		{
+			_buf[count++] = m_buf[tail];
+			tail = (tail + 1) & (_capacity - 1);
+		}
+
+		CSPSCQueue_BARRIER();
+		m_tail = tail;
+		return count;
+	}
+
+	// Consumer side, in place. Points _data at the oldest byte
+	// and returns how many follow it without wrapping. They
+	// stay put until consume()d.
+	unsigned int peek(const unsigned char *&_data)
+	{
+		unsigned char tail = m_tail;
+		unsigned char head = m_head;
+
+		CSPSCQueue_BARRIER();
+		_data = m_buf + tail;
+		if(head >= tail)
+			return head - tail;
+
+		return _capacity - tail;
+	}
+
+	void consume(unsigned int _len)
+	{
+		CSPSCQueue_BARRIER();
+		m_tail = (m_tail + _len) & (_capacity - 1);
+	}
+
+	unsigned int bytesAvailable()
+	{
+		return (unsigned char)(m_head - m_tail) & (_capacity - 1);
+	}
+
+	// Bytes dropped because the queue was full. This is more
+	// than a byte, so the consumer should read it with the
+	// producer's interrupt disabled.
+	unsigned int getOverruns()
+	{
+		return m_overruns;
+	}
+};
+
+#endif
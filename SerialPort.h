@@ -0,0 +1,288 @@
+////////////////////////////////////////////////////////////
+// Buffered serial port, bound to its UART at compile time
+////////////////////////////////////////////////////////////
+#ifndef SerialPort_h
+#define SerialPort_h
+
+////////////////////////////////////////////////////////////
+// Buffers traffic for one HardwareSerial port. The port is a
+// template parameter, so there is no switching on a port
+// number and no virtual calls; loop() and the timer ISR
+// call it directly. Use CComm_Arduino to hand it to code
+// that wants an ICommunicationInterface.
+//
+// The buffers are static, so they are all the RAM the port
+// will ever use.
+////////////////////////////////////////////////////////////
+#ifndef CSerialPort_TRANSMIT_BUFSIZE
+#define CSerialPort_TRANSMIT_BUFSIZE		(512)	// Bulk telemetry
+#endif
+
+#ifndef CSerialPort_URGENT_TRANSMIT_BUFSIZE
+#define CSerialPort_URGENT_TRANSMIT_BUFSIZE	(128)	// Acks, naks, state changes
+#endif
+
+#ifndef CSerialPort_RECEIVE_BUFSIZE
+#define CSerialPort_RECEIVE_BUFSIZE			(128)	// Commands from the house
+#endif
+
+#ifndef CSerialPort_RECEIVE_QUEUESIZE
+#define CSerialPort_RECEIVE_QUEUESIZE		(128)	// Filled by pollReceive(), power of two
+#endif
+
+// Largest chunk moved per tick, the size of the UART buffers
+#define CSerialPort_CHUNKSIZE	(64)
+
+template <HardwareSerial &_serial,
+		  unsigned int _transmitSize = CSerialPort_TRANSMIT_BUFSIZE,
+		  unsigned int _urgentTransmitSize = CSerialPort_URGENT_TRANSMIT_BUFSIZE,
+		  unsigned int _receiveSize = CSerialPort_RECEIVE_BUFSIZE>
+class CSerialPort
+{
+protected:
+	bool m_open;
+
+	CStaticSlidingBuffer<_transmitSize> m_transmitBuf;			// Bulk
+	CStaticSlidingBuffer<_urgentTransmitSize> m_urgentTransmitBuf;
+	CStaticSlidingBuffer<_receiveSize> m_receiveBuf;
+
+	// Received bytes on their way from the UART to m_receiveBuf.
+	// pollReceive() produces, tick() consumes.
+	CSPSCQueue<CSerialPort_RECEIVE_QUEUESIZE> m_receiveQueue;
+	volatile unsigned int m_uartFullCount;
+
+	// Takes received data in place, if attached. The sink may
+	// send replies, which ticks us again; m_inSink stops that
+	// from handing it more data before it returns.
+	ICommunicationSink *m_receiveSink;
+	bool m_inSink;
+
+	// Lanes only switch between records
+	unsigned char m_transmitDelimiter;
+	bool m_bulkInFlight;
+
+	// Pull up to _room bytes to send next. Urgent data goes first,
+	// unless a bulk record is partly sent, in which case just the
+	// rest of that record goes.
+	unsigned int nextTransmitChunk(unsigned char *_data, unsigned int _room)
+	{
+		unsigned int count = 0;
+
+		if(!m_bulkInFlight)
+		{
+			count = m_urgentTransmitBuf.read(_data, _room);
+			_room -= count;
+
+			// Bulk waits until the urgent lane is empty
+			if(m_urgentTransmitBuf.bytesAvailable())
+				return count;
+		}
+
+		if(_room)
+		{
+			unsigned int bulk = m_transmitBuf.read(_data + count, _room, false);
+
+			// Finish the record in flight and stop there if urgent data is waiting
+			if(m_bulkInFlight && m_urgentTransmitBuf.bytesAvailable())
+			{
+				unsigned char *eor = (unsigned char *)memchr(_data + count, m_transmitDelimiter, bulk);
+				if(eor)
+					bulk = (eor - (_data + count)) + 1;
+			}
+
+			m_transmitBuf.consume(bulk);
+			if(bulk)
+				m_bulkInFlight = (_data[count + bulk - 1] != m_transmitDelimiter);
+
+			count += bulk;
+		}
+
+		return count;
+	}
+
+public:
+	CSerialPort()
+	{
+		m_open = false;
+		m_uartFullCount = 0;
+		m_receiveSink = 0;
+		m_inSink = false;
+
+		m_transmitDelimiter = '\n';
+		m_bulkInFlight = false;
+	}
+
+	~CSerialPort()
+	{
+		close();
+	}
+
+	void open(unsigned long _baud)
+	{
+		_serial.begin(_baud);
+		m_open = true;
+	}
+
+	void close()
+	{
+		if(m_open)
+			_serial.end();
+
+		m_open = false;
+	}
+
+	unsigned int read(unsigned char *_buf, unsigned int _bufSize, bool _consume = true)
+	{
+		return m_receiveBuf.read(_buf, _bufSize, _consume);
+	}
+
+	unsigned int write(const unsigned char *_buf, unsigned int _bufSize)
+	{
+		return m_transmitBuf.write(_buf, _bufSize);
+	}
+
+	unsigned int writeUrgent(const unsigned char *_buf, unsigned int _bufSize)
+	{
+		return m_urgentTransmitBuf.write(_buf, _bufSize);
+	}
+
+	void setTransmitDelimiter(unsigned char _delimiter)
+	{
+		m_transmitDelimiter = _delimiter;
+	}
+
+	int bytesInReceiveBuffer()
+	{
+		return m_receiveBuf.bytesAvailable();
+	}
+
+	int bytesInTransmitBuffer()
+	{
+		return m_transmitBuf.bytesAvailable() + m_urgentTransmitBuf.bytesAvailable();
+	}
+
+	unsigned int bytesFreeInTransmitBuffer()
+	{
+		return m_transmitBuf.bytesFree();
+	}
+
+	unsigned int bytesFreeInUrgentTransmitBuffer()
+	{
+		return m_urgentTransmitBuf.bytesFree();
+	}
+
+	unsigned int discardTransmitRecords(unsigned int _minLen, unsigned char _delimiter)
+	{
+		return m_transmitBuf.discardRecords(_minLen, _delimiter);
+	}
+
+	void setReceiveSink(ICommunicationSink *_sink)
+	{
+		m_receiveSink = _sink;
+	}
+
+	int gets(char *_buf, int _bufSize)
+	{
+		return m_receiveBuf.gets(_buf, _bufSize);
+	}
+
+	bool puts(const char * _buf)
+	{
+		return m_transmitBuf.puts(_buf);
+	}
+
+	// Move whatever the UART has received into the receive
+	// queue. This is safe to call from an interrupt (a timer
+	// tick, say) so data keeps moving while loop() is busy,
+	// but it must never run in two places at once.
+	void pollReceive()
+	{
+		if(!m_open)
+			return;
+
+		// A full UART buffer has probably dropped bytes
+		int byteCount = _serial.available();
+		if(byteCount >= (SERIAL_RX_BUFFER_SIZE - 1))
+			m_uartFullCount++;
+
+		while(byteCount-- > 0)
+			m_receiveQueue.push(_serial.read());
+	}
+
+	// Bytes lost because the receive queue was full
+	unsigned int getReceiveOverruns()
+	{
+		noInterrupts();
+		unsigned int overruns = m_receiveQueue.getOverruns();
+		interrupts();
+		return overruns;
+	}
+
+	// Times the UART receive buffer was found full
+	unsigned int getUARTFullCount()
+	{
+		noInterrupts();
+		unsigned int fullCount = m_uartFullCount;
+		interrupts();
+		return fullCount;
+	}
+
+	void tick()
+	{
+		unsigned byteCount;
+		unsigned char data[CSerialPort_CHUNKSIZE];
+
+		if(!m_open)
+			return;
+
+		// Poll here too in case nothing else does. Interrupts are
+		// off so this and an ISR are never both producing.
+		noInterrupts();
+		pollReceive();
+		interrupts();
+
+		if(m_receiveSink)
+		{
+			// Hand it over straight from the queue
+			const unsigned char *received;
+			while(!m_inSink && ((byteCount = m_receiveQueue.peek(received)) != 0))
+			{
+				m_inSink = true;
+				m_receiveSink->receive(received, byteCount);
+				m_inSink = false;
+
+				m_receiveQueue.consume(byteCount);
+			}
+		}
+		else
+		{
+			// Only take what the receive buffer has room for; the
+			// rest waits in the queue
+			byteCount = m_receiveBuf.bytesFree();
+			if(byteCount > sizeof(data))
+				byteCount = sizeof(data);
+			byteCount = m_receiveQueue.read(data, byteCount);
+			if(byteCount)
+				m_receiveBuf.write(data, byteCount);
+		}
+
+		// Only send what the UART will take without blocking
+		byteCount = _serial.availableForWrite();
+		if(byteCount > sizeof(data))
+			byteCount = sizeof(data);
+		byteCount = nextTransmitChunk(data, byteCount);
+		if(byteCount)
+			_serial.write(data, byteCount);
+	}
+
+	bool wantsTick()
+	{
+		if(!m_open)
+			return false;
+
+		return m_transmitBuf.bytesAvailable() || m_urgentTransmitBuf.bytesAvailable() ||
+			   m_receiveQueue.bytesAvailable() || _serial.available();
+	}
+};
+
+#endif
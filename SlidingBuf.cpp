@@ -14,16 +14,35 @@ CSlidingBuffer::CSlidingBuffer()
 {
 	m_buf = 0;
 	m_bufLen = 0;
+	m_head = 0;
 	m_dataLen = 0;
+	m_lineCount = 0;
+	m_scanned = 0;
 	m_canGrow = true;
+	m_ownsBuf = true;
+}
+
+CSlidingBuffer::CSlidingBuffer(unsigned char *_storage, unsigned int _storageSize)
+{
+	m_buf = _storage;
+	m_bufLen = _storageSize;
+	m_head = 0;
+	m_dataLen = 0;
+	m_lineCount = 0;
+	m_scanned = 0;
+	m_canGrow = false;
+	m_ownsBuf = false;
 }
 
 CSlidingBuffer::~CSlidingBuffer()
 {
-	if(m_buf) free(m_buf);
+	if(m_buf && m_ownsBuf) free(m_buf);
 	m_buf = 0;
 	m_bufLen = 0;
+	m_head = 0;
 	m_dataLen = 0;
+	m_lineCount = 0;
+	m_scanned = 0;
 }
 
 void CSlidingBuffer::grow(unsigned int _newSize)
@@ -36,13 +55,16 @@ void CSlidingBuffer::grow(unsigned int _newSize)
 	unsigned int bufSizeNeeded = 0;
 	unsigned int nBlocks = 0;
 
+	// Fixed size buffers get one block, and that's it
 	if(!m_canGrow)
 	{
 		if(m_buf == 0)
 		{
 			m_buf = (unsigned char *)malloc(CSLIDING_BUFFER_BLOCKSIZE);
-			return;
+			if(m_buf)
+				m_bufLen = CSLIDING_BUFFER_BLOCKSIZE;
 		}
+		return;
 	}
 
 	// I can grow, so figure out how large
@@ -57,6 +79,15 @@ void CSlidingBuffer::grow(unsigned int _newSize)
 	else
 	{
 		m_buf = (unsigned char *)realloc(m_buf, bufSizeNeeded);
+
+		// If the data wrapped, move the part at the end of the
+		// old buffer to the end of the new one to keep it in order
+		if(m_head + m_dataLen > m_bufLen)
+		{
+			unsigned int headLen = m_bufLen - m_head;
+			memmove(m_buf + bufSizeNeeded - headLen, m_buf + m_head, headLen);
+			m_head = bufSizeNeeded - headLen;
+		}
 	}
 
 	m_bufLen = bufSizeNeeded;
@@ -71,26 +102,194 @@ void CSlidingBuffer::consume(unsigned int _consumeLen)
 	// as a special case
 	if(_consumeLen >= m_dataLen)
 	{
+		m_head = 0;
 		m_dataLen = 0;
+		m_lineCount = 0;
+		m_scanned = 0;
 		return;
 	}
 
+	// Only count if there is something to find
+	if(m_lineCount)
+		m_lineCount -= count('\n', 0, _consumeLen);
+	m_scanned = (m_scanned > _consumeLen) ? (m_scanned - _consumeLen) : 0;
+
+	m_head = wrap(_consumeLen);
 	m_dataLen -= _consumeLen;
-	memmove(m_buf, m_buf + _consumeLen, m_dataLen);
+}
+
+unsigned int CSlidingBuffer::bytesFree()
+{
+	// Growable buffers always have room
+	if(m_canGrow)
+		return (unsigned int) - 1;
+
+	// Fixed buffers are one block, even before it is allocated
+	if(!m_buf)
+		return CSLIDING_BUFFER_BLOCKSIZE;
+
+	return m_bufLen - m_dataLen;
+}
+
+long CSlidingBuffer::find(unsigned char _c, unsigned int _from)
+{
+	const unsigned char *first, *second;
+	unsigned int firstLen, secondLen;
+	const unsigned char *found;
+
+	peek(first, firstLen, second, secondLen);
+
+	if(_from < firstLen)
+	{
+		found = (const unsigned char *)memchr(first + _from, _c, firstLen - _from);
+		if(found)
+			return found - first;
+
+		_from = firstLen;
+	}
+
+	if(_from < m_dataLen)
+	{
+		found = (const unsigned char *)memchr(second + (_from - firstLen), _c, m_dataLen - _from);
+		if(found)
+			return firstLen + (found - second);
+	}
+
+	return -1;
+}
+
+unsigned int CSlidingBuffer::count(unsigned char _c, unsigned int _from, unsigned int _to)
+{
+	unsigned int nFound = 0;
+
+	// A contiguous piece at a time
+	while(_from < _to)
+	{
+		unsigned int at = wrap(_from);
+		unsigned int runLen = m_bufLen - at;
+		if(runLen > _to - _from)
+			runLen = _to - _from;
+
+		const unsigned char *found = m_buf + at;
+		const unsigned char *end = found + runLen;
+		while((found = (const unsigned char *)memchr(found, _c, end - found)) != 0)
+		{
+			nFound++;
+			found++;
+		}
+
+		_from += runLen;
+	}
+
+	return nFound;
+}
+
+unsigned int CSlidingBuffer::findLineEnd()
+{
+	unsigned int offset = m_scanned;
+
+	// A contiguous piece at a time
+	while(offset < m_dataLen)
+	{
+		unsigned int at = wrap(offset);
+		unsigned int runLen = m_bufLen - at;
+		if(runLen > m_dataLen - offset)
+			runLen = m_dataLen - offset;
+
+		const unsigned char *c = m_buf + at;
+		for(unsigned int i = 0; i < runLen; ++i)
+			if((c[i] == '\n') || (c[i] == '\0'))
+				return offset + i;
+
+		offset += runLen;
+	}
+
+	return m_dataLen;
+}
+
+// Discard whole records (each ending with _delimiter) until at least
+// _minLen bytes have been freed. The first record is never touched
+// because it may already be partly sent, and neither is an unfinished
+// record at the tail. Returns the number of records discarded.
+unsigned int CSlidingBuffer::discardRecords(unsigned int _minLen, unsigned char _delimiter)
+{
+	if(!m_buf || !m_dataLen)
+		return 0;
+
+	// Skip the first record
+	long eor = find(_delimiter, 0);
+	if(eor < 0)
+		return 0;
+	unsigned int from = eor + 1;
+
+	// Find how many whole records to remove
+	unsigned int to = from;
+	unsigned int nRecords = 0;
+	while((to < m_dataLen) && ((to - from) < _minLen))
+	{
+		eor = find(_delimiter, to);
+		if(eor < 0)
+			break;
+
+		to = eor + 1;
+		nRecords++;
+	}
+
+	// Close the gap by moving the first record up to meet the
+	// rest. It is only one sentence, so this is cheaper than
+	// moving everything after the gap.
+	unsigned int gap = to - from;
+	if(gap)
+	{
+		if(m_lineCount)
+			m_lineCount -= count('\n', from, to);
+		if(m_scanned > from)
+			m_scanned = from;
+
+		for(unsigned int offset = from; offset > 0; --offset)
+			m_buf[wrap(offset - 1 + gap)] = m_buf[wrap(offset - 1)];
+
+		m_head = wrap(gap);
+		m_dataLen -= gap;
+	}
+
+	return nRecords;
+}
+
+unsigned int CSlidingBuffer::peek(const unsigned char *&_first, unsigned int &_firstLen,
+								  const unsigned char *&_second, unsigned int &_secondLen)
+{
+	// From the head to the end of the buffer, then the wrapped part
+	_first = m_buf + m_head;
+	_firstLen = m_bufLen - m_head;
+	if(_firstLen > m_dataLen)
+		_firstLen = m_dataLen;
+
+	_second = m_buf;
+	_secondLen = m_dataLen - _firstLen;
+
+	return m_dataLen;
 }
 
 unsigned int CSlidingBuffer::read(unsigned char *_buf, unsigned int _bufSize, bool _consume)
 {
+	const unsigned char *first, *second;
+	unsigned int firstLen, secondLen;
 	unsigned int amountToCopy = 0;
 
-	amountToCopy = bytesAvailable();
+	amountToCopy = peek(first, firstLen, second, secondLen);
 	if(amountToCopy > (_bufSize))
 		amountToCopy = _bufSize;
 
 	if(amountToCopy <= 0)
 		return 0;
 
-	memmove(_buf, m_buf, amountToCopy);
+	if(firstLen > amountToCopy)
+		firstLen = amountToCopy;
+
+	memcpy(_buf, first, firstLen);
+	if(amountToCopy > firstLen)
+		memcpy(_buf + firstLen, second, amountToCopy - firstLen);
 
 	if(_consume)
 		consume(amountToCopy);
@@ -103,6 +302,8 @@ unsigned int CSlidingBuffer::write(const unsigned char *_buf, unsigned int _bufS
 	unsigned int bufSizeNeeded = 0;
 	unsigned int freeSpace = 0;
 	unsigned int lenToAdd = 0;
+	unsigned int tail = 0;
+	unsigned int firstLen = 0;
 
 	// Don't be stupid
 	if(!_buf) return 0;
@@ -118,102 +319,109 @@ unsigned int CSlidingBuffer::write(const unsigned char *_buf, unsigned int _bufS
 	lenToAdd = (freeSpace < _bufSize) ? freeSpace : _bufSize;
 
 	if(lenToAdd == 0)
-		lenToAdd = 0;
+		return 0;
+
+	// Now add the data to the end of the buffer, wrapping
+	// around to the start if need be
+	tail = wrap(m_dataLen);
+	firstLen = m_bufLen - tail;
+	if(firstLen > lenToAdd)
+		firstLen = lenToAdd;
 
-	// Now add the data to the end of the buffer
-	memmove(m_buf + m_dataLen, _buf, lenToAdd);
+	memcpy(m_buf + tail, _buf, firstLen);
+	if(lenToAdd > firstLen)
+		memcpy(m_buf, _buf + firstLen, lenToAdd - firstLen);
 	m_dataLen += lenToAdd;
 
+	// Keep track of complete lines for gets()
+	const unsigned char *eol = _buf;
+	const unsigned char *end = _buf + lenToAdd;
+	while((eol = (const unsigned char *)memchr(eol, '\n', end - eol)) != 0)
+	{
+		m_lineCount++;
+		eol++;
+	}
+
 	return lenToAdd;
 }
 
-#define SKIPWHITESPACE(c) {while(*c && isspace(*c)) ++c; }
+// Scan only what arrived since the last call, stopping at the first
+// newline or null. The line count lets callers (and gets() itself)
+// skip the whole thing when no complete line is waiting.
 int CSlidingBuffer::gets(char *_buf, int _bufSize)
 {
-	unsigned char buf[CSLIDING_BUFFER_BLOCKSIZE];
-	int len = 0;
-	unsigned char *start = 0;
-	unsigned char *end = 0;
-	unsigned char *eol = 0;
-	int lenToConsume = 0;
+	unsigned int eol = 0;
+	unsigned int start = 0;
+	unsigned int end = 0;
 	int lineLen = 0;
-	unsigned int iBytesAvailable = bytesAvailable();
 
 	// Check for empty
-	if(!iBytesAvailable)
+	if(!m_dataLen)
 		return 0;
 
-	// Get the data
-	len = read(buf, sizeof(buf) - 1, false);
-	if(!len)
-		return 0;
+	// Look for the end of the line (or a null) in the new data
+	if(m_lineCount)
+	{
+		eol = findLineEnd();
+	}
+	else
+	{
+		// Only a null could turn up; don't look at old data again
+		long null = find('\0', m_scanned);
+		eol = (null < 0) ? m_dataLen : (unsigned int)null;
+	}
 
-	// Terminate
-	buf[len] = 0;
+	m_scanned = eol;
 
-	// Check for eol
+	if((eol == m_dataLen) || (m_buf[wrap(eol)] == '\0'))
+	{
+		// If it is just running away, then flush the
+		// buffer and start waiting for a newline
+		if(m_dataLen == m_bufLen)
+		{
+			consume(m_dataLen);
+			return 0;
+		}
 
-	eol = (unsigned char *)strstr(( char *)buf, "\n");
+		// Wait for more
+		if(eol == m_dataLen)
+			return 0;
 
-	if(eol == 0)
-	{
-		// If it is just running away, then
-		// flush the buffer
-		// and start waiting for a
-		// newline
-		if(iBytesAvailable == m_bufLen)
+		// There is a special case where we can get a null characters
+		// into the buffer. If this happens then Gets will bind.
+		// By dumping a null-terminated string without a newline
+		// character this is detected and stopped
+		if(eol > 0)
 		{
-			consume(iBytesAvailable);
+			// It is just an ugly null terminated string
+			// so eat it and it's null
+			consume(eol + 1);
 		}
 		else
 		{
-			// There is a special case where we can get a null characters
-			// into the buffer. If this happens then Gets will bind.
-			// By dumping a null-terminated string without a newline
-			// character this is detected and stopped
-			int bufStrlen = strlen((const char *)buf);
-			if((bufStrlen > 0) && (bufStrlen < len))
-			{
-				// It is just an ugly null terminated string
-				// so eat it and it's null
-				consume(bufStrlen + 1);
-			}
-			else
-			{
-				int iNullCount = 0;
-
-				// It must be a bunch of nulls
-				for(iNullCount = 0; iNullCount < len; ++iNullCount)
-					if(buf[iNullCount] != '\0')
-						break;
-
-				consume(iNullCount);
-			}
+			// It must be a bunch of nulls
+			while((eol < m_dataLen) && (m_buf[wrap(eol)] == '\0'))
+				++eol;
+
+			consume(eol);
 		}
 		return 0;
 	}
 
-	// Figure out how much we are going
-	// to consume
-	lenToConsume = (eol - buf) + 1;
-
-	// Eat leading whitespace
-	start = buf;
-	SKIPWHITESPACE(start);
+	// Eat leading and trailing whitespace
+	start = 0;
+	while((start < eol) && isspace(m_buf[wrap(start)]))
+		++start;
 
-	// Eat trailing whitespace
 	end = eol;
-	while(isspace(*end) && (end >= start))
-	{
-		*end = 0;
+	while((end > start) && isspace(m_buf[wrap(end - 1)]))
 		--end;
-	}
 
 	// Is there anything left?
-	lineLen = (end - start) + 1;
+	lineLen = end - start;
 	if(lineLen <= 0)
 	{
-		consume(lenToConsume);
+		consume(eol + 1);
 		return 0;
 	}
 
@@ -228,15 +436,39 @@ int CSlidingBuffer::gets(char *_buf, int _bufSize)
 		return -1;
 
 	// Copy the data
-	strcpy(_buf, (char *)start);
+	for(int offset = 0; offset < lineLen; ++offset)
+		_buf[offset] = m_buf[wrap(start + offset)];
+	_buf[lineLen] = 0;
 
 	// Remove the requested data from
 	// my buffer
-	consume(lenToConsume);
+	consume(eol + 1);
 
 	return lineLen;
 }
 
+int CSlidingBuffer::getLines(char *_buf, int _bufSize, CSlidingBuffer_LineFunction _lineFunction, void *_context)
+{
+	int nLines = 0;
+
+	// Every gets() starts where the last one stopped, so
+	// this is one pass over the data
+	while(m_lineCount)
+	{
+		int lineLen = gets(_buf, _bufSize);
+		if(lineLen < 0)
+			break;
+
+		if(lineLen > 0)
+		{
+			_lineFunction(_buf, lineLen, _context);
+			nLines++;
+		}
+	}
+
+	return nLines;
+}
+
 bool CSlidingBuffer::puts(const char * _buf)
 {
 	if(!_buf)
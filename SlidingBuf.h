@@ -1,34 +1,77 @@
 /////////////////////////////////////////////////////////////////////////
 // A generic sliding data buffer; Functions as a FIFO
+//
+// The data lives in a circular buffer, so consuming from the head
+// is just an index update. The data may wrap around the end of the
+// buffer, which is why peek() returns up to two spans.
 /////////////////////////////////////////////////////////////////////////
 #ifndef SlidingBuf_h
 #define SlidingBuf_h
 
 // Initial buffer size and realloc growth
-// NOTE: *** ALSO IMPLIES MAXIMUM LINE LENGTH FOR Gets()
+// NOTE: *** ALSO IMPLIES MAXIMUM LINE LENGTH FOR Gets() IF IT CAN'T GROW
 #define CSLIDING_BUFFER_BLOCKSIZE	(512)
 
+// Called by getLines() for each line
+typedef void (*CSlidingBuffer_LineFunction)(const char *_line, int _len, void *_context);
+
 class CSlidingBuffer
 {
 protected:
 	unsigned char *m_buf;
 	unsigned int m_bufLen;
+	unsigned int m_head;		// Offset of the oldest byte
 	unsigned int m_dataLen;
 
+	// For gets(). Newlines waiting in the buffer, and how far
+	// from the head is known to hold no newline or null.
+	unsigned int m_lineCount;
+	unsigned int m_scanned;
+
 	bool m_canGrow;
+	bool m_ownsBuf;		// False if the storage belongs to a subclass
 	void grow(unsigned int _newSize);
 
+	// Buffer offset of the byte _offset from the head
+	unsigned int wrap(unsigned int _offset)
+	{
+		_offset += m_head;
+		return (_offset >= m_bufLen) ? (_offset - m_bufLen) : _offset;
+	}
+
+	// Offset from the head of the first _c at or after _from,
+	// or -1 if there isn't one
+	long find(unsigned char _c, unsigned int _from);
+
+	// Count of _c between the offsets _from and _to
+	unsigned int count(unsigned char _c, unsigned int _from, unsigned int _to);
+
+	// Offset of the first newline or null not yet scanned,
+	// or m_dataLen if there isn't one
+	unsigned int findLineEnd();
+
+	// For subclasses that provide their own storage
+	CSlidingBuffer(unsigned char *_storage, unsigned int _storageSize);
+
 public:
 	CSlidingBuffer();
 	virtual ~CSlidingBuffer();
 	void setCanGrow(bool _canGrow)
 	{
-		m_canGrow = _canGrow;
+		// Storage we didn't allocate can't be realloc()ed
+		m_canGrow = _canGrow && m_ownsBuf;
 	}
 	int bytesAvailable()
 	{
 		return m_dataLen;
 	}
+	unsigned int bytesFree();
+
+	// Look at the data in place. The second span is empty unless
+	// the data wraps. The pointers are only good until the next
+	// write, consume or discard. Returns the total length.
+	unsigned int peek(const unsigned char *&_first, unsigned int &_firstLen,
+					  const unsigned char *&_second, unsigned int &_secondLen);
 
 	virtual unsigned int read(unsigned char *_buf, unsigned int _bufSize, bool _consume = true);
 	virtual unsigned int write(const unsigned char *_buf, unsigned int _bufSize);
@@ -36,9 +79,41 @@ public:
 	void consume(unsigned int _consumeLen);	// Remove data from the head
 	// of the buffer
 
+	// Remove whole delimited records, oldest first, to free
+	// at least _minLen bytes. The first record is kept.
+	unsigned int discardRecords(unsigned int _minLen, unsigned char _delimiter);
+
+	// Complete lines waiting for gets()
+	unsigned int linesAvailable()
+	{
+		return m_lineCount;
+	}
+
 	virtual int gets(char *_buf, int _bufSize);
+
+	// Pull every complete line in one pass, handing each to
+	// _lineFunction (as gets() would return it in _buf).
+	// Returns the number of lines. Stops early if a line
+	// doesn't fit in _buf.
+	int getLines(char *_buf, int _bufSize, CSlidingBuffer_LineFunction _lineFunction, void *_context);
 	virtual bool puts(const char * _buf);
 };
 
+/////////////////////////////////////////////////////////////////////////
+// A sliding buffer with its storage inside the object, sized at
+// compile time. Nothing comes from the heap, and it never grows.
+/////////////////////////////////////////////////////////////////////////
+template <unsigned int _capacity>
+class CStaticSlidingBuffer : public CSlidingBuffer
+{
+protected:
+	unsigned char m_storage[_capacity];
+
+public:
+	CStaticSlidingBuffer() : CSlidingBuffer(m_storage, _capacity)
+	{
+	}
+};
+
 /////////////////////////////////////////////////////////////////////////
 #endif
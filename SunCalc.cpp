@@ -10,6 +10,8 @@
 #include "Telemetry.h"
 #include "TelemetryTags.h"
 #include "MilliTimer.h"
+#include "TelemetryScheduler.h"
+#include "TaskScheduler.h"
 
 #include "Pins.h"
 #include "SunCalc.h"
@@ -19,6 +21,8 @@
 #include "BeepController.h"
 #include "GaryCooper.h"
 
+#include "GPSClock.h"
+
 extern CGPSParser g_GPSParser;
 
 ////////////////////////////////////////////////////////////
@@ -31,9 +35,22 @@ extern CGPSParser g_GPSParser;
 
 CSunCalc::CSunCalc()
 {
-	m_currentTime = CSunCalc_INVALID_TIME;
+	m_havePosition = false;
+	m_lat = 0.;
+	m_lon = 0.;
 	m_sunriseTime = CSunCalc_INVALID_TIME;
 	m_sunsetTime = CSunCalc_INVALID_TIME;
+
+	m_cacheValid = false;
+	m_cacheYear = 0;
+	m_cacheMonth = 0;
+	m_cacheDay = 0;
+	m_cacheLat = 0;
+	m_cacheLon = 0;
+	m_cacheSunriseTime = CSunCalc_INVALID_TIME;
+	m_cacheSunsetTime = CSunCalc_INVALID_TIME;
+	m_cacheHits = 0;
+	m_cacheMisses = 0;
 }
 
 CSunCalc::~CSunCalc()
@@ -44,7 +61,6 @@ CSunCalc::~CSunCalc()
 bool CSunCalc::processGPSData(CGPSParserData &_gpsData)
 {
 	// Assume he worst
-	m_currentTime = CSunCalc_INVALID_TIME;
 	m_sunriseTime = CSunCalc_INVALID_TIME;
 	m_sunsetTime = CSunCalc_INVALID_TIME;
 
@@ -56,32 +72,50 @@ bool CSunCalc::processGPSData(CGPSParserData &_gpsData)
 	double lat = _gpsData.m_position.m_lat;
 	double lon = _gpsData.m_position.m_lon;
 
-	// If we don't have a lock then
-	// don't bother with the other stuff because
-	// it will not be set
+	// If we don't have a lock then the GPS data will
+	// not be set, but the clock and the last position
+	// can carry on without it
 	if(!_gpsData.m_GPSLocked)
 	{
 #ifdef DEBUG_SUNCALC
 		DEBUG_SERIAL.println(F("CSunCalc - GPS not locked."));
 #endif
 		reportError(telemetry_error_GPS_not_locked, true);
-		return false;
 	}
 	else
 	{
 		reportError(telemetry_error_GPS_not_locked, false);
-	}
 
 #ifdef DEBUG_SUNCALC
-	DEBUG_SERIAL.println(F("CSunCalc - GPS locked."));
+		DEBUG_SERIAL.println(F("CSunCalc - GPS locked."));
 #endif
 
+		// Make sure we have good data
+		if(!GPS_IS_VALID_DATA(_gpsData.m_date.m_year) ||
+				!GPS_IS_VALID_DATA(_gpsData.m_date.m_month) ||
+				!GPS_IS_VALID_DATA(_gpsData.m_date.m_day) ||
+				!GPS_IS_VALID_DATA(_gpsData.m_time.m_hour) ||
+				!GPS_IS_VALID_DATA(_gpsData.m_time.m_minute) ||
+				!GPS_IS_VALID_DATA(lat) ||
+				!GPS_IS_VALID_DATA(lon))
+		{
+			reportError(telemetry_error_GPS_bad_data, true);
+		}
+		else
+		{
+			reportError(telemetry_error_GPS_bad_data, false);
+
+			m_lat = lat;
+			m_lon = lon;
+			m_havePosition = true;
+		}
+	}
+
 	// Date
-	int year = _gpsData.m_date.m_year;
-	int month = _gpsData.m_date.m_month;
-	int day = _gpsData.m_date.m_day;
-	int hour = _gpsData.m_time.m_hour;
-	int minute = _gpsData.m_time.m_minute;
+	int year, month, day;
+	double currentTime;
+	if(!m_havePosition || !g_GPSClock.getUTC(year, month, day, currentTime))
+		return false;
 
 #ifdef DEBUG_SUNCALC
 	DEBUG_SERIAL.print(F("CSunCalc - Date: "));
@@ -92,43 +126,50 @@ bool CSunCalc::processGPSData(CGPSParserData &_gpsData)
 	DEBUG_SERIAL.println(year);
 
 	DEBUG_SERIAL.print(F("CSunCalc - Lat: "));
-	DEBUG_SERIAL.print(lat);
+	DEBUG_SERIAL.print(m_lat);
 	DEBUG_SERIAL.print(F(" Lon: "));
-	DEBUG_SERIAL.println(lon);
+	DEBUG_SERIAL.println(m_lon);
 	DEBUG_SERIAL.println();
 #endif
 
-	// Make sure we have good data
-	if(!GPS_IS_VALID_DATA(year) ||
-			!GPS_IS_VALID_DATA(month) ||
-			!GPS_IS_VALID_DATA(day) ||
-			!GPS_IS_VALID_DATA(hour) ||
-			!GPS_IS_VALID_DATA(minute) ||
-			!GPS_IS_VALID_DATA(lat) ||
-			!GPS_IS_VALID_DATA(lon))
+	// Figure the rise and set times if the date or
+	// position has changed since last time
+	long cacheLat = (long)floor((m_lat * CSunCalc_POSITION_STEPS) + 0.5);
+	long cacheLon = (long)floor((m_lon * CSunCalc_POSITION_STEPS) + 0.5);
+	if(m_cacheValid &&
+			(year == m_cacheYear) &&
+			(month == m_cacheMonth) &&
+			(day == m_cacheDay) &&
+			(cacheLat == m_cacheLat) &&
+			(cacheLon == m_cacheLon))
 	{
-		reportError(telemetry_error_GPS_bad_data, true);
-		return false;
+		m_cacheHits++;
 	}
 	else
 	{
-		reportError(telemetry_error_GPS_bad_data, false);
-	}
+		m_cacheMisses++;
+
+		civil_twilight( year, month, day, m_lon, m_lat,
+						&m_cacheSunriseTime, &m_cacheSunsetTime);
 
-	// Figure current time
-	m_currentTime = hour + (minute / 60.);
+		// Make sure the times make sense
+		normalizeTime(m_cacheSunriseTime);
+		normalizeTime(m_cacheSunsetTime);
 
-	// Get the rise and set times
-	civil_twilight( year, month, day, lon, lat,
-					&m_sunriseTime, &m_sunsetTime);
+		m_cacheValid = true;
+		m_cacheYear = year;
+		m_cacheMonth = month;
+		m_cacheDay = day;
+		m_cacheLat = cacheLat;
+		m_cacheLon = cacheLon;
+	}
 
-	// Make sure the times make sense
-	normalizeTime(m_sunriseTime);
-	normalizeTime(m_sunsetTime);
+	m_sunriseTime = m_cacheSunriseTime;
+	m_sunsetTime = m_cacheSunsetTime;
 
 #ifdef DEBUG_SUNCALC
 	DEBUG_SERIAL.print(F("CSunCalc - Current Time (UTC): "));
-	debugPrintDoubleTime(m_currentTime);
+	debugPrintDoubleTime(currentTime);
 
 	DEBUG_SERIAL.print(F("CSunCalc - Sunrise - Sunset (UTC): "));
 	debugPrintDoubleTime(m_sunriseTime, false);
@@ -141,12 +182,22 @@ bool CSunCalc::processGPSData(CGPSParserData &_gpsData)
 	return true;
 }
 
-void CSunCalc::sendTelemetry()
+double CSunCalc::getCurrentTime()
+{
+	int year, month, day;
+	double currentTime;
+	if(!g_GPSClock.getUTC(year, month, day, currentTime))
+		return CSunCalc_INVALID_TIME;
+
+	return currentTime;
+}
+
+void CSunCalc::sendGPSStatusTelemetry()
 {
 	const char *emptyS = "";
 
 	// Telemetry
-	CGPSParserData gpsData = g_GPSParser.getGPSData();
+	CGPSParserData &gpsData = g_GPSParser.getGPSData();
 
 	g_telemetry.transmissionStart();
 	g_telemetry.sendTerm(telemetry_tag_GPSStatus);
@@ -164,15 +215,24 @@ void CSunCalc::sendTelemetry()
 		g_telemetry.sendTerm(emptyS);
 	}
 	g_telemetry.transmissionEnd();
+}
+
+void CSunCalc::sendDateTimeTelemetry()
+{
+	const char *emptyS = "";
+
+	// Telemetry
+	int year, month, day;
+	double currentTime;
 
 	g_telemetry.transmissionStart();
 	g_telemetry.sendTerm(telemetry_tag_date_time);
-	if(gpsData.m_GPSLocked)
+	if(g_GPSClock.getUTC(year, month, day, currentTime))
 	{
-		g_telemetry.sendTerm(gpsData.m_date.m_year);
-		g_telemetry.sendTerm(gpsData.m_date.m_month);
-		g_telemetry.sendTerm(gpsData.m_date.m_day);
-		g_telemetry.sendTerm(m_currentTime);
+		g_telemetry.sendTerm(year);
+		g_telemetry.sendTerm(month);
+		g_telemetry.sendTerm(day);
+		g_telemetry.sendTerm(currentTime);
 	}
 	else
 	{
@@ -182,7 +242,10 @@ void CSunCalc::sendTelemetry()
 		g_telemetry.sendTerm(emptyS);
 	}
 	g_telemetry.transmissionEnd();
+}
 
+void CSunCalc::sendSunTimesTelemetry()
+{
 	g_telemetry.transmissionStart();
 	g_telemetry.sendTerm(telemetry_tag_sun_times);
 	g_telemetry.sendTerm(m_sunriseTime);
@@ -190,6 +253,15 @@ void CSunCalc::sendTelemetry()
 	g_telemetry.transmissionEnd();
 }
 
+void CSunCalc::sendSunCacheTelemetry()
+{
+	g_telemetry.transmissionStart();
+	g_telemetry.sendTerm(telemetry_tag_sun_cache);
+	g_telemetry.sendTerm(m_cacheHits);
+	g_telemetry.sendTerm(m_cacheMisses);
+	g_telemetry.transmissionEnd();
+}
+
 bool timeIsBetween(double _currentTime, double _first, double _second)
 {
 	// See if they are practically the same
@@ -207,7 +279,7 @@ bool timeIsBetween(double _currentTime, double _first, double _second)
 	else
 	{
 		if(	((_currentTime >= _first) && (_currentTime < 24.)) ||
-				((_currentTime > 0.) && (_currentTime < _second)) )
+				((_currentTime >= 0.) && (_currentTime < _second)) )
 			return true;
 		else
 			return false;
@@ -10,17 +10,40 @@
 // integer and decimal hours instead of minutes in the fractional.
 // ie 11:30 AM (UTC) is represented as 11.50, 11:45 AM (UTC)
 // is represented as 11.75, and so on.
+//
+// The time and date come from the GPS clock, so they keep
+// going while the lock is lost, at the last position seen.
 ////////////////////////////////////////////////////////////
 #define CSunCalc_INVALID_TIME	(-999)
 
+// The sun times only change with the date and the position,
+// so they are kept until one of those does. Positions are
+// compared to 1/CSunCalc_POSITION_STEPS of a degree, about
+// a kilometer, which moves the times by seconds.
+#define CSunCalc_POSITION_STEPS	(100)
+
 class CSunCalc
 {
 protected:
 
-	double m_currentTime;
+	bool m_havePosition;
+	double m_lat;
+	double m_lon;
 	double m_sunriseTime;	// Civil
 	double m_sunsetTime;	// Civil
 
+	// What the times were last figured for
+	bool m_cacheValid;
+	int m_cacheYear;
+	int m_cacheMonth;
+	int m_cacheDay;
+	long m_cacheLat;
+	long m_cacheLon;
+	double m_cacheSunriseTime;
+	double m_cacheSunsetTime;
+	unsigned long m_cacheHits;
+	unsigned long m_cacheMisses;
+
 public:
 	CSunCalc();
 	virtual ~CSunCalc();
@@ -32,11 +55,7 @@ public:
 		return false;
 	}
 
-	double getCurrentTime()
-	{
-		return m_currentTime;
-	}
-
+	double getCurrentTime();
 
 	double getSunriseTime()
 	{
@@ -48,8 +67,22 @@ public:
 		return m_sunsetTime;
 	}
 
+	unsigned long getCacheHits()
+	{
+		return m_cacheHits;
+	}
+
+	unsigned long getCacheMisses()
+	{
+		return m_cacheMisses;
+	}
+
 	bool processGPSData(CGPSParserData &_gpsData);
-	void sendTelemetry();
+
+	void sendGPSStatusTelemetry();
+	void sendDateTimeTelemetry();
+	void sendSunTimesTelemetry();
+	void sendSunCacheTelemetry();
 };
 
 // Deal with rolling to the next day
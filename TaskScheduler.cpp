@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////
+// Task Scheduler
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+
+#include "TaskScheduler.h"
+
+CTaskScheduler::CTaskScheduler()
+{
+	for(int task = 0; task < CTaskScheduler_MAX_TASKS; ++task)
+	{
+		m_tasks[task].m_function = 0;
+		m_tasks[task].m_context = 0;
+		m_tasks[task].m_periodMS = 0;
+		m_tasks[task].m_deadlineMS = 0;
+		m_tasks[task].m_scheduled = false;
+	}
+
+	m_nTasks = 0;
+	m_queueLen = 0;
+}
+
+CTaskScheduler::~CTaskScheduler()
+{
+}
+
+int CTaskScheduler::addTask(CTaskScheduler_TaskFunction _function, void *_context)
+{
+	if(!_function || (m_nTasks >= CTaskScheduler_MAX_TASKS))
+		return CTaskScheduler_NO_TASK;
+
+	m_tasks[m_nTasks].m_function = _function;
+	m_tasks[m_nTasks].m_context = _context;
+
+	return m_nTasks++;
+}
+
+// Insert in deadline order. Ties go behind, so equal
+// deadlines run in the order they were scheduled.
+void CTaskScheduler::enqueue(int _task)
+{
+	uint32_t deadline = m_tasks[_task].m_deadlineMS;
+
+	int slot = m_queueLen;
+	while((slot > 0) && ((int32_t)(deadline - m_tasks[(int)m_queue[slot - 1]].m_deadlineMS) < 0))
+	{
+		m_queue[slot] = m_queue[slot - 1];
+		--slot;
+	}
+
+	m_queue[slot] = _task;
+	m_queueLen++;
+	m_tasks[_task].m_scheduled = true;
+}
+
+void CTaskScheduler::dequeue(int _task)
+{
+	if(!m_tasks[_task].m_scheduled)
+		return;
+
+	int slot = 0;
+	while((slot < m_queueLen) && (m_queue[slot] != _task))
+		++slot;
+
+	for(; slot < m_queueLen - 1; ++slot)
+		m_queue[slot] = m_queue[slot + 1];
+
+	m_queueLen--;
+	m_tasks[_task].m_scheduled = false;
+}
+
+void CTaskScheduler::schedule(int _task, unsigned long _delayMS, unsigned long _periodMS)
+{
+	if((_task < 0) || (_task >= m_nTasks))
+		return;
+
+	dequeue(_task);
+
+	m_tasks[_task].m_periodMS = _periodMS;
+	m_tasks[_task].m_deadlineMS = millis() + _delayMS;
+
+	enqueue(_task);
+}
+
+void CTaskScheduler::cancel(int _task)
+{
+	if((_task < 0) || (_task >= m_nTasks))
+		return;
+
+	dequeue(_task);
+}
+
+bool CTaskScheduler::isScheduled(int _task)
+{
+	if((_task < 0) || (_task >= m_nTasks))
+		return false;
+
+	return m_tasks[_task].m_scheduled;
+}
+
+void CTaskScheduler::tick()
+{
+	uint32_t now = millis();
+
+	// A task that reschedules itself for now runs again
+	// next tick, not forever in this one
+	for(int run = 0; (run < m_nTasks) && m_queueLen; ++run)
+	{
+		int task = m_queue[0];
+		CTaskScheduler_TaskS &entry = m_tasks[task];
+
+		// Nothing (more) is due
+		if((int32_t)(now - entry.m_deadlineMS) < 0)
+			return;
+
+		dequeue(task);
+
+		// Periodic tasks go back in before they run, so they can
+		// cancel or reschedule themselves. If we fell more than
+		// a period behind, don't try to catch up.
+		if(entry.m_periodMS)
+		{
+			entry.m_deadlineMS += entry.m_periodMS;
+			if((int32_t)(now - entry.m_deadlineMS) >= 0)
+				entry.m_deadlineMS = now + entry.m_periodMS;
+
+			enqueue(task);
+		}
+
+		entry.m_function(entry.m_context);
+	}
+}
+
+unsigned long CTaskScheduler::timeToNextDeadline()
+{
+	if(!m_queueLen)
+		return CTaskScheduler_NO_DEADLINE;
+
+	long remaining = (int32_t)(m_tasks[(int)m_queue[0]].m_deadlineMS - millis());
+	return (remaining > 0) ? (unsigned long)remaining : 0;
+}
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////
+// Task Scheduler
+////////////////////////////////////////////////////////////
+#ifndef TaskScheduler_h
+#define TaskScheduler_h
+
+////////////////////////////////////////////////////////////
+// Runs periodic and one-shot tasks when they come due.
+// Modules add a task once (a function and a context
+// pointer, usually the module itself) and then schedule,
+// reschedule or cancel it. Scheduled tasks are kept sorted
+// by deadline, so tick() only looks at the ones that are
+// due, and timeToNextDeadline() tells the caller how long
+// it can wait (or sleep) before there is work to do.
+// Deadlines are millis() values and rollover safe.
+////////////////////////////////////////////////////////////
+#define CTaskScheduler_MAX_TASKS	(10)
+#define CTaskScheduler_NO_TASK		(-1)
+
+// timeToNextDeadline() when nothing is scheduled
+#define CTaskScheduler_NO_DEADLINE	(0xFFFFFFFFUL)
+
+// Called when a task is due
+typedef void (*CTaskScheduler_TaskFunction)(void *_context);
+
+class CTaskScheduler
+{
+protected:
+	typedef struct
+	{
+		CTaskScheduler_TaskFunction m_function;
+		void *m_context;
+		unsigned long m_periodMS;		// Zero for one-shot
+		uint32_t m_deadlineMS;			// millis() when due
+		bool m_scheduled;
+	} CTaskScheduler_TaskS;
+
+	CTaskScheduler_TaskS m_tasks[CTaskScheduler_MAX_TASKS];
+	int m_nTasks;
+
+	// Scheduled tasks, soonest deadline first
+	signed char m_queue[CTaskScheduler_MAX_TASKS];
+	int m_queueLen;
+
+	void enqueue(int _task);
+	void dequeue(int _task);
+
+public:
+	CTaskScheduler();
+	virtual ~CTaskScheduler();
+
+	// Returns the task ID, or CTaskScheduler_NO_TASK if
+	// there is no room. The task isn't scheduled yet.
+	int addTask(CTaskScheduler_TaskFunction _function, void *_context);
+
+	// Run the task _delayMS from now, then every _periodMS
+	// if that isn't zero. Replaces any earlier schedule.
+	void schedule(int _task, unsigned long _delayMS, unsigned long _periodMS = 0);
+	void cancel(int _task);
+	bool isScheduled(int _task);
+
+	// Run what is due. Each due task runs once per tick.
+	void tick();
+
+	// Milliseconds until the next task is due, zero if one
+	// is due now
+	unsigned long timeToNextDeadline();
+};
+
+#endif
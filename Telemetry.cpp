@@ -1,17 +1,41 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <stdint.h>
 
 #include "ICommInterface.h"
 #include "Telemetry.h"
 
-static char *Telemetry_ItoA(int num, char* str, int base);
-static char *Telemetry_DtoA(char *str, double num, int places);
+template<class T> static unsigned int Telemetry_UtoA(T _value, char *_str);
+template<class T> static unsigned int Telemetry_ItoA(T _value, char *_str);
+static unsigned int Telemetry_DtoA(char *str, double num, int places);
+static char *Telemetry_DtoA_Exponent(char *str, double num, int places);
+static unsigned int Telemetry_CRC16(const unsigned char *_buf, unsigned int _len);
+static unsigned int Telemetry_COBSEncode(const unsigned char *_src, unsigned int _len, unsigned char *_dst);
 
 CTelemetry::CTelemetry()
 {
 	m_commInterface = 0;
 	m_receiveTarget = 0;
+
+	reset();
+
+	m_transmitLength = 0;
+	m_transmitTermNumber = 0;
+	m_transmitChecksum = 0;
+	m_transmitOverflow = false;
+	m_transmitFormat = CTelemetry_Format_ASCII;
+	m_formatPending = false;
+	m_pendingFormat = CTelemetry_Format_ASCII;
+
+	m_deltaMode = false;
+	m_transmitTag = -1;
+	m_lastSentValid = 0;
+
+	m_transmitPriority = CTelemetry_Priority_Bulk;
+	m_droppedSentences[CTelemetry_Priority_Bulk] = 0;
+	m_droppedSentences[CTelemetry_Priority_Urgent] = 0;
+	m_evictedSentences = 0;
 }
 
 CTelemetry::~CTelemetry()
@@ -21,8 +45,46 @@ CTelemetry::~CTelemetry()
 void CTelemetry::setInterfaces(ICommunicationInterface *_commInterface,
 							   ITelemetry_ReceiveTarget *_receiveTarget)
 {
+	if(m_commInterface)
+		m_commInterface->setReceiveSink(0);
+
 	m_commInterface = _commInterface;
 	m_receiveTarget = _receiveTarget;
+
+	// Parse received data in place rather than pulling it
+	if(m_commInterface)
+		m_commInterface->setReceiveSink(this);
+
+	setTransmitFormat(m_formatPending ? m_pendingFormat : m_transmitFormat);
+}
+
+void CTelemetry::setTransmitFormat(CTelemetry_FormatE _format)
+{
+	m_pendingFormat = _format;
+	m_formatPending = true;
+
+	// Right away if nothing is queued
+	switchTransmitFormat();
+}
+
+void CTelemetry::switchTransmitFormat()
+{
+	if(!m_formatPending)
+		return;
+
+	// Queued records end with the old delimiter, and a bulk
+	// record may be part way out. Both are done once the
+	// transmit buffer is empty.
+	if(m_commInterface && m_commInterface->bytesInTransmitBuffer())
+		return;
+
+	m_transmitFormat = m_pendingFormat;
+	m_formatPending = false;
+	requestKeyframe();
+
+	// So the comm interface knows where sentences end
+	if(m_commInterface)
+		m_commInterface->setTransmitDelimiter((m_transmitFormat == CTelemetry_Format_Binary) ? 0 : '\n');
 }
 
 void CTelemetry::tick()
@@ -30,9 +92,13 @@ void CTelemetry::tick()
 	if(!m_commInterface)
 		return;
 
+	switchTransmitFormat();
+
+	// Data normally arrives through receive(). This picks up
+	// anything that was buffered before we attached.
 	while(m_commInterface->bytesInReceiveBuffer())
 	{
-		char parseBuff[256];
+		char parseBuff[64];
 
 		int dataLen = m_commInterface->read((unsigned char *)parseBuff, sizeof(parseBuff));
 		if(dataLen)
@@ -44,17 +110,32 @@ void CTelemetry::tick()
 }
 
 // Interface for sending data
-void CTelemetry::transmissionStart()
+void CTelemetry::transmissionStart(CTelemetry_PriorityE _priority)
 {
 	// Make sure we have a comm interface to send it
 	if(!m_commInterface)
 		return;
 
+	switchTransmitFormat();
+
+	m_transmitPriority = _priority;
 	m_transmitTermNumber = 0;
 	m_transmitChecksum = 0;
+	m_transmitTag = -1;
+	m_transmitOverflow = false;
 
-	m_commInterface->puts("$");
-	m_commInterface->tick();
+	// Binary frames start with the length, which
+	// is filled in by binaryTransmissionEnd()
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		m_transmitSentence[0] = 0;
+		m_transmitLength = 1;
+		return;
+	}
+
+	// The '$' is not part of the checksum
+	m_transmitSentence[0] = '$';
+	m_transmitLength = 1;
 }
 
 void CTelemetry::sendTerm(const char *_value)
@@ -63,88 +144,429 @@ void CTelemetry::sendTerm(const char *_value)
 	if(!m_commInterface)
 		return;
 
+	// Binary strings are length prefixed. Empty terms
+	// are sent as an empty field.
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		unsigned int len = (_value) ? strlen(_value) : 0;
+		if(len == 0)
+		{
+			addTransmitField(CTelemetry_Field_Empty, 0, 0);
+			return;
+		}
+
+		if(len > CTelemetry_TERMSIZE)
+			len = CTelemetry_TERMSIZE;
+
+		unsigned char data[CTelemetry_TERMSIZE + 1];
+		data[0] = (unsigned char)len;
+		memcpy(data + 1, _value, len);
+		addTransmitField(CTelemetry_Field_String, data, len + 1);
+		return;
+	}
 
-	// Copy the data to the buffer, prepending a comma if needed
-	char termBuf[CTelemetry_TERMSIZE * 2];
-	termBuf[0] = '\0';
+	// Prepend a comma if needed
 	if(m_transmitTermNumber)
-		strcpy(termBuf, ",");
-	strncat(termBuf, _value, sizeof(termBuf));
+		addTransmitChar(',');
 
-	// Calculate the checksum
-	for(const char *c = termBuf; *c; c++)
-		m_transmitChecksum ^= (int)(*c);
+	// Copy the term into the sentence, checksumming as we go
+	if(_value)
+	{
+		for(const char *c = _value; *c; c++)
+			addTransmitChar(*c);
+	}
 
 	// Bump term number
 	m_transmitTermNumber++;
-
-	// Finally, send the data
-	m_commInterface->puts(termBuf);
-	m_commInterface->tick();
 }
 
 void CTelemetry::sendTerm(int _value)
 {
-	char numberBuf[CTelemetry_TERMSIZE + 1];
-	Telemetry_ItoA(_value, numberBuf, 10);
-	sendTerm(numberBuf);
+	// The first term is the tag
+	if(m_transmitTermNumber == 0)
+		m_transmitTag = _value;
+
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		// The first term is the tag, which becomes the frame type
+		if(m_transmitTermNumber == 0)
+		{
+			if(!m_commInterface)
+				return;
+
+			addTransmitChar((char)_value);
+			m_transmitTermNumber++;
+			return;
+		}
+
+		addTransmitInteger(CTelemetry_Field_Int, (unsigned long)_value, 2);
+		return;
+	}
+
+	char term[CTelemetry_MAX_INTEGER_CHARS + 1];
+	addTransmitTerm(term, Telemetry_ItoA(_value, term));
 }
 
 void CTelemetry::sendTerm(unsigned int _value)
 {
-	char numberBuf[CTelemetry_TERMSIZE + 1];
-	Telemetry_ItoA(_value, numberBuf, 10);
-	sendTerm(numberBuf);
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		addTransmitInteger(CTelemetry_Field_UInt, (unsigned long)_value, 2);
+		return;
+	}
+
+	char term[CTelemetry_MAX_INTEGER_CHARS + 1];
+	addTransmitTerm(term, Telemetry_UtoA(_value, term));
+}
+
+void CTelemetry::sendTerm(long _value)
+{
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		addTransmitInteger(CTelemetry_Field_Long, (unsigned long)_value, 4);
+		return;
+	}
+
+	char term[CTelemetry_MAX_INTEGER_CHARS + 1];
+	addTransmitTerm(term, Telemetry_ItoA(_value, term));
 }
 
+void CTelemetry::sendTerm(unsigned long _value)
+{
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		addTransmitInteger(CTelemetry_Field_ULong, _value, 4);
+		return;
+	}
+
+	char term[CTelemetry_MAX_INTEGER_CHARS + 1];
+	addTransmitTerm(term, Telemetry_UtoA(_value, term));
+}
 
 void CTelemetry::sendTerm(bool _value)
 {
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		unsigned char data = (_value) ? 1 : 0;
+		addTransmitField(CTelemetry_Field_Bool, &data, sizeof(data));
+		return;
+	}
+
 	sendTerm((_value) ? 1 : 0);
 }
 
-void CTelemetry::sendTerm(double _value)
+void CTelemetry::sendTerm(double _value, int _decimals)
 {
-	char numberBuf[CTelemetry_TERMSIZE + 1];
-	Telemetry_DtoA(numberBuf, _value, 2);
-	sendTerm(numberBuf);
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		// Both the AVR and the house are little-endian, so
+		// the float goes out as-is
+		float f = (float)_value;
+		addTransmitField(CTelemetry_Field_Float, &f, sizeof(f));
+		return;
+	}
+
+	char term[CTelemetry_TERMSIZE + 1];
+	addTransmitTerm(term, Telemetry_DtoA(term, _value, _decimals));
 }
 
-static const char *s_hexChars = "0123456789ABCDEF";
+const char g_telemetryHexChars[] = "0123456789ABCDEF";
+
 void CTelemetry::transmissionEnd()
 {
 	// Make sure we have a comm interface to send it
 	if(!m_commInterface)
 		return;
 
-	// Create the checksum string
-	char termBuf[6];
-	termBuf[0] = '*';
-	termBuf[1] = s_hexChars[((m_transmitChecksum & 0xF0) >> 4)];
-	termBuf[2] = s_hexChars[(m_transmitChecksum & 0x0F)];
-	termBuf[3] = '\r';
-	termBuf[4] = '\n';
-	termBuf[5] = '\0';
-
-	// Send it
-	m_commInterface->puts(termBuf);
+	// Bulk waits for a format change, so the lanes can drain.
+	// The change requests a keyframe, so nothing is lost.
+	if(m_formatPending && (m_transmitPriority == CTelemetry_Priority_Bulk))
+	{
+		m_transmitLength = 0;
+		return;
+	}
+
+	// A sentence with a term missing would be misread, so
+	// one that outgrew the buffer isn't sent at all
+	if(m_transmitOverflow)
+	{
+		m_droppedSentences[m_transmitPriority]++;
+		forgetSentence();
+		m_transmitLength = 0;
+		return;
+	}
+
+	// Skip sentences the house already has
+	if(!sentenceChanged())
+	{
+		m_transmitLength = 0;
+		return;
+	}
+
+	if(m_transmitFormat == CTelemetry_Format_Binary)
+	{
+		binaryTransmissionEnd();
+		return;
+	}
+
+	// Append the checksum and EOL. addTransmitChar() always
+	// leaves room for these
+	m_transmitSentence[m_transmitLength++] = '*';
+	m_transmitSentence[m_transmitLength++] = g_telemetryHexChars[((m_transmitChecksum & 0xF0) >> 4)];
+	m_transmitSentence[m_transmitLength++] = g_telemetryHexChars[(m_transmitChecksum & 0x0F)];
+	m_transmitSentence[m_transmitLength++] = '\r';
+	m_transmitSentence[m_transmitLength++] = '\n';
+
+	// Send the whole sentence at once
+	admitSentence((const unsigned char *)m_transmitSentence, m_transmitLength, '\n');
+
+	m_transmitLength = 0;
+}
+
+// Add a character to the outgoing sentence and the running
+// checksum, but do not overrun the buffer. Room is reserved
+// for the "*CS\r\n" trailer.
+#define CTelemetry_TRAILERSIZE	(5)
+void CTelemetry::addTransmitChar(char _c)
+{
+	if(m_transmitLength < (CTelemetry_SENTENCESIZE - CTelemetry_TRAILERSIZE))
+	{
+		m_transmitSentence[m_transmitLength++] = _c;
+		m_transmitChecksum ^= (int)_c;
+	}
+	else
+		m_transmitOverflow = true;
+}
+
+// Add a formatted ASCII term of _len characters to the
+// sentence. A term that doesn't fit fails the sentence.
+void CTelemetry::addTransmitTerm(const char *_term, unsigned int _len)
+{
+	if(!m_commInterface)
+		return;
+
+	// Prepend a comma if needed
+	if(m_transmitTermNumber)
+		addTransmitChar(',');
+
+	m_transmitTermNumber++;
+
+	if((m_transmitLength + _len) > (CTelemetry_SENTENCESIZE - CTelemetry_TRAILERSIZE))
+	{
+		m_transmitOverflow = true;
+		return;
+	}
+
+	for(unsigned int i = 0; i < _len; ++i)
+		m_transmitChecksum ^= (int)_term[i];
+
+	memcpy(m_transmitSentence + m_transmitLength, _term, _len);
+	m_transmitLength += _len;
+}
+
+// Add a little-endian integer field of _size bytes to the binary frame
+void CTelemetry::addTransmitInteger(unsigned char _fieldType, unsigned long _value, unsigned int _size)
+{
+	unsigned char data[4];
+	for(unsigned int i = 0; i < _size; ++i)
+	{
+		data[i] = (unsigned char)(_value & 0xFF);
+		_value >>= 8;
+	}
+
+	addTransmitField(_fieldType, data, _size);
+}
+
+// Add a typed field to the binary frame. A field that will
+// not fit fails the frame.
+void CTelemetry::addTransmitField(unsigned char _fieldType, const void *_data, unsigned int _dataLen)
+{
+	if(!m_commInterface)
+		return;
+
+	if((m_transmitLength + 1 + _dataLen) <= (CTelemetry_SENTENCESIZE - CTelemetry_TRAILERSIZE))
+	{
+		addTransmitChar((char)_fieldType);
+		for(unsigned int i = 0; i < _dataLen; ++i)
+			addTransmitChar(((const char *)_data)[i]);
+	}
+	else
+		m_transmitOverflow = true;
+
+	m_transmitTermNumber++;
+}
+
+// Returns true if the sentence being assembled should be sent.
+// Always true unless delta mode is on and this tag's last
+// sentence was identical.
+bool CTelemetry::sentenceChanged()
+{
+	if(!m_deltaMode)
+		return true;
+
+	if((m_transmitTag < 0) || (m_transmitTag >= CTelemetry_MAX_TRACKED_TAGS))
+		return true;
+
+	unsigned int signature = Telemetry_CRC16((const unsigned char *)m_transmitSentence, m_transmitLength);
+	unsigned int tagBit = (1U << m_transmitTag);
+
+	if((m_lastSentValid & tagBit) && (m_lastSentSignature[m_transmitTag] == signature))
+		return false;
+
+	m_lastSentSignature[m_transmitTag] = signature;
+	m_lastSentValid |= tagBit;
+	return true;
+}
+
+void CTelemetry::binaryTransmissionEnd()
+{
+	// Fill in the length (type and fields), then the CRC
+	m_transmitSentence[0] = (char)(m_transmitLength - 1);
+
+	unsigned int crc = Telemetry_CRC16((const unsigned char *)m_transmitSentence, m_transmitLength);
+	m_transmitSentence[m_transmitLength++] = (char)(crc & 0xFF);
+	m_transmitSentence[m_transmitLength++] = (char)((crc >> 8) & 0xFF);
+
+	// COBS encode it and add the frame delimiter. COBS adds one
+	// byte per 254, and our frames are shorter than that.
+	unsigned char frame[CTelemetry_SENTENCESIZE + 2];
+	unsigned int frameLen = Telemetry_COBSEncode((const unsigned char *)m_transmitSentence, m_transmitLength, frame);
+	frame[frameLen++] = 0;
+
+	// Send the whole frame at once
+	admitSentence(frame, frameLen, 0);
+
+	m_transmitLength = 0;
+}
+
+// Hand a finished sentence to the comm interface, but only if all
+// of it fits in its lane of the transmit buffer; half a sentence is
+// just wasted airtime. Urgent sentences have their own lane, which
+// is always sent first. A full bulk lane drops its oldest sentences,
+// which are the most out of date. _delimiter is the last byte of
+// every sentence in this format.
+bool CTelemetry::admitSentence(const unsigned char *_buf, unsigned int _len, unsigned char _delimiter)
+{
+	if(m_transmitPriority == CTelemetry_Priority_Urgent)
+	{
+		if(m_commInterface->bytesFreeInUrgentTransmitBuffer() < _len)
+		{
+			m_droppedSentences[CTelemetry_Priority_Urgent]++;
+			forgetSentence();
+			return false;
+		}
+
+		m_commInterface->writeUrgent(_buf, _len);
+		m_commInterface->tick();
+		return true;
+	}
+
+	unsigned int freeSpace = m_commInterface->bytesFreeInTransmitBuffer();
+	if(freeSpace < _len)
+	{
+		unsigned int evicted = m_commInterface->discardTransmitRecords(_len - freeSpace, _delimiter);
+		if(evicted)
+		{
+			// We don't know what was lost, so resend everything
+			m_evictedSentences += evicted;
+			requestKeyframe();
+		}
+
+		freeSpace = m_commInterface->bytesFreeInTransmitBuffer();
+	}
+
+	if(freeSpace < _len)
+	{
+		m_droppedSentences[CTelemetry_Priority_Bulk]++;
+		forgetSentence();
+		return false;
+	}
+
+	m_commInterface->write(_buf, _len);
 	m_commInterface->tick();
+	return true;
+}
+
+// The house never got this one, so don't count it as sent
+void CTelemetry::forgetSentence()
+{
+	if((m_transmitTag >= 0) && (m_transmitTag < CTelemetry_MAX_TRACKED_TAGS))
+		m_lastSentValid &= ~(1U << m_transmitTag);
 }
 
 // =========================================================
 // Returns true if any sentences were processed (data may have changed)
 void CTelemetry::parse(const unsigned char *_buf, unsigned int _bufLen)
 {
-	unsigned int index;
 	const unsigned char *cPtr = _buf;
+	const unsigned char *end = _buf + _bufLen;
 
 	// Sanity
 	if((_buf == 0) || (_bufLen == 0))
 		return;
 
-	// parse it one character at a time.
-	for(index = 0; index < _bufLen; ++index)
-		parseChar(*cPtr++);
+	// Work through the buffer a run at a time where we
+	// can, and one character at a time where we can't
+	while(cPtr < end)
+	{
+		switch(m_state)
+		{
+		// Skip straight to the next '$'
+		case TParser_S_WaitingForStart:
+			cPtr = (const unsigned char *)memchr(cPtr, '$', end - cPtr);
+			if(!cPtr)
+				return;
+			parseChar(*cPtr++);
+			break;
+
+		case TParser_S_ParsingTerms:
+			cPtr = parseTermRun(cPtr, end);
+			break;
+
+		// The checksum is only a couple of characters
+		default:
+			parseChar(*cPtr++);
+			break;
+		}
+	}
+}
+
+// Scan term characters up to the next delimiter, folding them
+// into the checksum. A term that is wholly inside the buffer is
+// handed to the receive target in place. Anything else is
+// accumulated and left to parseChar(), so the results are the
+// same as parsing one character at a time. Returns where to
+// continue.
+const unsigned char *CTelemetry::parseTermRun(const unsigned char *_start, const unsigned char *_end)
+{
+	const unsigned char *c = _start;
+	unsigned char checksum = m_receiveChecksum;
+
+	while((c < _end) && (*c != ',') && (*c != '*') && (*c != '$') && (*c != '\n'))
+		checksum ^= *c++;
+
+	m_receiveChecksum = checksum;
+
+	// Whole term in one piece with nothing carried over?
+	if((c < _end) && ((*c == ',') || (*c == '*')) && (m_receiveTermOffset == 0))
+	{
+		if(*c == ',')
+			m_receiveChecksum ^= *c;
+
+		if(m_receiveTarget)
+			m_receiveTarget->receiveTermSpan(m_receiveTermNumber, (const char *)_start, c - _start);
+
+		nextTerm(*c);
+		return c + 1;
+	}
+
+	// Keep what we have and let the state machine
+	// deal with the delimiter
+	addReceiveTermChars(_start, c - _start);
+	if(c < _end)
+		parseChar(*c++);
+
+	return c;
 }
 
 // This method was inspired by Mikal Hart's TinyGPS
@@ -200,13 +622,7 @@ void CTelemetry::parseChar(unsigned char _c)
 			processTerm();
 
 			// And start the next
-			m_receiveTermOffset = 0;
-			m_receiveTerm[m_receiveTermOffset] = '\0';
-			m_receiveTermNumber++;
-
-			// Star also ends the current term, and it changes state to checksum processing
-			if(_c == '*')
-				m_state = TParser_S_ProcessingChecksum;
+			nextTerm(_c);
 			break;
 
 		default:
@@ -273,10 +689,48 @@ void CTelemetry::addReceiveTermChar(unsigned char _c)
 	}
 }
 
+// Add a run of characters to the accumulating term,
+// again without overrunning the buffer
+void CTelemetry::addReceiveTermChars(const unsigned char *_c, unsigned int _len)
+{
+	unsigned int room = (CTelemetry_TERMSIZE - 1) - m_receiveTermOffset;
+	if(_len > room)
+		_len = room;
+
+	memcpy(m_receiveTerm + m_receiveTermOffset, _c, _len);
+	m_receiveTermOffset += _len;
+	m_receiveTerm[m_receiveTermOffset] = '\0';
+}
+
+// Start accumulating the next term. Star also ends the
+// current term, and it changes state to checksum processing
+void CTelemetry::nextTerm(unsigned char _c)
+{
+	m_receiveTermOffset = 0;
+	m_receiveTerm[m_receiveTermOffset] = '\0';
+	m_receiveTermNumber++;
+
+	if(_c == '*')
+		m_state = TParser_S_ProcessingChecksum;
+}
+
 void CTelemetry::processTerm()
 {
 	if(m_receiveTarget)
-		m_receiveTarget->receiveTerm(m_receiveTermNumber, m_receiveTerm);
+		m_receiveTarget->receiveTermSpan(m_receiveTermNumber, m_receiveTerm, m_receiveTermOffset);
+}
+
+void ITelemetry_ReceiveTarget::receiveTermSpan(int _index, const char *_value, unsigned int _len)
+{
+	char term[CTelemetry_TERMSIZE];
+
+	if(_len > (CTelemetry_TERMSIZE - 1))
+		_len = CTelemetry_TERMSIZE - 1;
+
+	memcpy(term, _value, _len);
+	term[_len] = '\0';
+
+	receiveTerm(_index, term);
 }
 
 
@@ -302,12 +756,106 @@ unsigned char CTelemetry::from_hex(unsigned char _a)
 }
 
 
+// Powers of ten for fixed point scaling
+static const unsigned long s_powersOfTen[CTelemetry_MAX_DECIMALS + 1] =
+{
+	1UL, 10UL, 100UL, 1000UL, 10000UL
+};
+
+/**
+ * Double to ASCII using fixed point. The value is scaled and
+ * rounded once, then the digits come from integer arithmetic.
+ * Up to _places decimals are written with trailing zeros
+ * removed, so 6.25 is "6.25", 12.0 is "12", and 0 is "0".
+ * Values too large for a 32 bit fixed point number are rare
+ * and go to the slower exponent-capable routine.
+ * Writes at most CTelemetry_TERMSIZE characters plus a
+ * terminator, and returns the number of characters written.
+ */
+static unsigned int Telemetry_DtoA(char *str, double num, int places)
+{
+	// handle special cases
+	if (isnan(num))
+	{
+		strcpy(str, "nan");
+		return 3;
+	}
+
+	if (isinf(num))
+	{
+		strcpy(str, "inf");
+		return 3;
+	}
+
+	if (places < 0)
+		places = 0;
+	if (places > CTelemetry_MAX_DECIMALS)
+		places = CTelemetry_MAX_DECIMALS;
+
+	bool neg = (num < 0);
+	if (neg)
+		num = -num;
+
+	// Scale and round once
+	double scaled = (num * s_powersOfTen[places]) + 0.5;
+	if (scaled >= 4294967295.)
+	{
+		char expBuf[32];
+		Telemetry_DtoA_Exponent(expBuf, (neg) ? -num : num, places);
+
+		unsigned int len = strlen(expBuf);
+		if (len > CTelemetry_TERMSIZE)
+			len = CTelemetry_TERMSIZE;
+		memcpy(str, expBuf, len);
+		str[len] = '\0';
+		return len;
+	}
+
+	unsigned long fixed = (unsigned long)scaled;
+	unsigned long whole = fixed / s_powersOfTen[places];
+	unsigned long fraction = fixed - (whole * s_powersOfTen[places]);
+
+	// Drop trailing zeros from the fraction
+	while ((places > 0) && fraction && ((fraction % 10) == 0))
+	{
+		fraction /= 10;
+		places--;
+	}
+
+	char *c = str;
+
+	// No "-0"
+	if (neg && fixed)
+		*(c++) = '-';
+
+	c += Telemetry_UtoA(whole, c);
+
+	// Fraction, with leading zeros
+	if (fraction)
+	{
+		*(c++) = '.';
+		for (int i = places - 1; i >= 0; --i)
+		{
+			unsigned long next = fraction / 10;
+			c[i] = '0' + (char)(fraction - (next * 10));
+			fraction = next;
+		}
+		c += places;
+	}
+
+	*c = '\0';
+	return c - str;
+}
+
 /**
  * Double to ASCII
  * "Borrowed" from androider at
  * http://stackoverflow.com/questions/2302969/how-to-implement-char-ftoafloat-num-without-sprintf-library-function-i
+ *
+ * Only used for values too large for Telemetry_DtoA() to
+ * handle in fixed point.
  */
-static char *Telemetry_DtoA(char *str, double num, int places)
+static char *Telemetry_DtoA_Exponent(char *str, double num, int places)
 {
 
 	double precision = (1.0) / (pow(10, (double)(places + 1)));
@@ -409,71 +957,128 @@ static char *Telemetry_DtoA(char *str, double num, int places)
 	return str;
 }
 
-/* A C++ program to implement itoa() */
+// Unsigned type and largest power of ten for each integer size
+template<int SIZE> struct Telemetry_DecimalTraits;
 
-template<class T> inline
-void swap(T &first, T &second)
+template<> struct Telemetry_DecimalTraits<2>
 {
-	if (&first != &second)
-	{
-		T tmp = first;
-		first = second;
-		second = tmp;
-	}
-}
+	typedef uint16_t unsignedT;
+	static const uint16_t topPower = 10000U;
+};
+
+template<> struct Telemetry_DecimalTraits<4>
+{
+	typedef uint32_t unsignedT;
+	static const uint32_t topPower = 1000000000UL;
+};
 
-/* A utility function to reverse a string  */
-static void Telemetry_Reverse(char str[], int length)
+template<> struct Telemetry_DecimalTraits<8>
 {
-	int start = 0;
-	int end = length - 1;
-	while (start < end)
+	typedef uint64_t unsignedT;
+	static const uint64_t topPower = 10000000000000000000ULL;
+};
+
+// Unsigned to base 10 ASCII, most significant digit first so no
+// reversal is needed. Digits come from subtracting the power of ten,
+// which is cheaper than division on the AVR. No terminator is
+// written. Returns the number of characters written.
+template<class T> static unsigned int Telemetry_UtoA(T _value, char *_str)
+{
+	typedef typename Telemetry_DecimalTraits<sizeof(T)>::unsignedT U;
+	U value = (U)_value;
+	U power = Telemetry_DecimalTraits<sizeof(T)>::topPower;
+	char *c = _str;
+
+	// Skip leading zeros, but always write at least one digit
+	while((power > 1) && (value < power))
+		power /= 10;
+
+	for(; power; power /= 10)
 	{
-		swap(*(str + start), *(str + end));
-		start++;
-		end--;
+		char digit = '0';
+		while(value >= power)
+		{
+			value -= power;
+			digit++;
+		}
+		*(c++) = digit;
 	}
+
+	return c - _str;
 }
 
-// Implementation of itoa()
-static char* Telemetry_ItoA(int num, char* str, int base)
+// Signed to base 10 ASCII. The magnitude is taken in the unsigned
+// type so the most negative value is handled.
+template<class T> static unsigned int Telemetry_ItoA(T _value, char *_str)
 {
-	int i = 0;
-	bool isNegative = false;
+	typedef typename Telemetry_DecimalTraits<sizeof(T)>::unsignedT U;
 
-	/* Handle 0 explicitely, otherwise empty string is printed for 0 */
-	if (num == 0)
+	if(_value < 0)
 	{
-		str[i++] = '0';
-		str[i] = '\0';
-		return str;
+		_str[0] = '-';
+		return 1 + Telemetry_UtoA((U)((U)0 - (U)_value), _str + 1);
 	}
 
-	// In standard itoa(), negative numbers are handled only with
-	// base 10. Otherwise numbers are considered unsigned.
-	if (num < 0 && base == 10)
-	{
-		isNegative = true;
-		num = -num;
-	}
+	return Telemetry_UtoA((U)_value, _str);
+}
+
+unsigned int Telemetry_UtoA(unsigned long _value, char *_str)
+{
+	return Telemetry_UtoA<unsigned long>(_value, _str);
+}
+
+// CRC-16/CCITT (poly 0x1021, initial value 0xFFFF)
+static unsigned int Telemetry_CRC16(const unsigned char *_buf, unsigned int _len)
+{
+	unsigned int crc = 0xFFFF;
 
-	// Process individual digits
-	while (num != 0)
+	for(unsigned int i = 0; i < _len; ++i)
 	{
-		int rem = num % base;
-		str[i++] = (rem > 9) ? (rem - 10) + 'a' : rem + '0';
-		num = num / base;
+		crc ^= ((unsigned int)_buf[i]) << 8;
+		for(int bit = 0; bit < 8; ++bit)
+		{
+			if(crc & 0x8000)
+				crc = (crc << 1) ^ 0x1021;
+			else
+				crc <<= 1;
+		}
 	}
 
-	// If number is negative, append '-'
-	if (isNegative)
-		str[i++] = '-';
+	return crc & 0xFFFF;
+}
 
-	str[i] = '\0'; // Append string terminator
+// Consistent Overhead Byte Stuffing. Removes all zeros from the
+// data so that 0x00 can be used as the frame delimiter. _dst must
+// hold _len + 1 bytes (plus one more per 254 bytes of data).
+static unsigned int Telemetry_COBSEncode(const unsigned char *_src, unsigned int _len, unsigned char *_dst)
+{
+	unsigned int readIndex = 0;
+	unsigned int writeIndex = 1;
+	unsigned int codeIndex = 0;
+	unsigned char code = 1;
 
-	// Reverse the string
-	Telemetry_Reverse(str, i);
+	while(readIndex < _len)
+	{
+		if(_src[readIndex] == 0)
+		{
+			_dst[codeIndex] = code;
+			code = 1;
+			codeIndex = writeIndex++;
+			readIndex++;
+		}
+		else
+		{
+			_dst[writeIndex++] = _src[readIndex++];
+			code++;
+			if(code == 0xFF)
+			{
+				_dst[codeIndex] = code;
+				code = 1;
+				codeIndex = writeIndex++;
+			}
+		}
+	}
 
-	return str;
+	_dst[codeIndex] = code;
+	return writeIndex;
 }
-
@@ -9,13 +9,72 @@ public:
 	virtual void receiveTerm(int _index, const char *_value) = 0;
 	virtual void receiveChecksumCorrect() = 0;
 	virtual void receiveChecksumError() = 0;
+
+	// Terms are handed over in place, as a pointer and length
+	// that are only valid during the call. The default copies
+	// the term (truncated to CTelemetry_TERMSIZE - 1) and
+	// calls receiveTerm().
+	virtual void receiveTermSpan(int _index, const char *_value, unsigned int _len);
 };
 
 // Largest distance between commas and such
 #define CTelemetry_TERMSIZE		(16)
 
-// The telemetry module
-class CTelemetry
+// Largest complete outgoing sentence ($ through \r\n)
+#define CTelemetry_SENTENCESIZE	(128)
+
+// Longest integer term, including the sign
+#define CTelemetry_MAX_INTEGER_CHARS	(sizeof(long) * 3 + 1)
+
+// Decimal places sent for doubles (ASCII format)
+#define CTelemetry_DEF_DECIMALS	(3)
+#define CTelemetry_MAX_DECIMALS	(4)
+
+// Sentence priorities. Each has its own transmit lane and urgent
+// is always sent first. When the bulk lane is full its oldest
+// sentences are pushed out.
+typedef enum
+{
+	CTelemetry_Priority_Bulk = 0,	// Periodic status
+	CTelemetry_Priority_Urgent,		// Acks, naks, error and door state changes
+	CTelemetry_Priority_Count
+} CTelemetry_PriorityE;
+
+// Tags below this have their last sent sentence tracked
+// for delta transmission. Tags at or above it (acks,
+// naks) are events and always go out.
+#define CTelemetry_MAX_TRACKED_TAGS	(16)
+
+// Outgoing wire formats
+typedef enum
+{
+	CTelemetry_Format_ASCII = 0,	// $tag,term,term*CS\r\n
+	CTelemetry_Format_Binary		// COBS framed, see below
+} CTelemetry_FormatE;
+
+////////////////////////////////////////////////////////////
+// Binary frame layout (before COBS encoding):
+//
+//	length		1 byte, count of type and field bytes
+//	type		1 byte, the first term (telemetryTagE)
+//	fields		field type byte followed by its data
+//	CRC			2 bytes, CRC-16/CCITT of all the above
+//
+// The frame is then COBS encoded and terminated with
+// a 0x00 byte. Multi-byte values are little-endian.
+////////////////////////////////////////////////////////////
+#define CTelemetry_Field_Empty		(0)		// No data (empty ASCII term)
+#define CTelemetry_Field_Int		(1)		// 2 bytes signed
+#define CTelemetry_Field_UInt		(2)		// 2 bytes unsigned
+#define CTelemetry_Field_Bool		(3)		// 1 byte, 0 or 1
+#define CTelemetry_Field_Float		(4)		// 4 bytes IEEE single
+#define CTelemetry_Field_String		(5)		// 1 byte length, then chars
+#define CTelemetry_Field_Long		(6)		// 4 bytes signed
+#define CTelemetry_Field_ULong		(7)		// 4 bytes unsigned
+
+// The telemetry module. It attaches itself to the comm
+// interface as a sink and parses received data in place.
+class CTelemetry : public ICommunicationSink
 {
 protected:
 
@@ -46,7 +105,10 @@ protected:
 
 	// Parser processing
 	void parseChar(unsigned char _c);
+	const unsigned char *parseTermRun(const unsigned char *_start, const unsigned char *_end);
 	void addReceiveTermChar(unsigned char _c);
+	void addReceiveTermChars(const unsigned char *_c, unsigned int _len);
+	void nextTerm(unsigned char _c);
 
 	void processTerm();		// Returns true when valid and recognized sentence is complete
 	unsigned char from_hex(unsigned char _a);
@@ -54,9 +116,46 @@ protected:
 	void reset();
 
 
-	// Members for sending data
+	// Members for sending data. The whole sentence is
+	// assembled here and handed to the comm interface
+	// in one write by transmissionEnd()
+	char m_transmitSentence[CTelemetry_SENTENCESIZE];
+	unsigned int m_transmitLength;
 	int m_transmitTermNumber;
 	int m_transmitChecksum;
+	bool m_transmitOverflow;		// A term didn't fit, so the sentence isn't sent
+
+	CTelemetry_FormatE m_transmitFormat;
+
+	// A format change waits until everything queued in the old
+	// format has gone out, since the comm interface finds the
+	// record boundaries with the format's delimiter
+	bool m_formatPending;
+	CTelemetry_FormatE m_pendingFormat;
+	void switchTransmitFormat();
+
+	// Delta transmission. A signature of the last sentence
+	// sent for each tag is kept, and unchanged sentences
+	// are not sent again until the next keyframe.
+	bool m_deltaMode;
+	int m_transmitTag;
+	unsigned int m_lastSentSignature[CTelemetry_MAX_TRACKED_TAGS];
+	unsigned int m_lastSentValid;		// Bit per tag
+	bool sentenceChanged();
+
+	// Transmit buffer admission
+	CTelemetry_PriorityE m_transmitPriority;
+	unsigned long m_droppedSentences[CTelemetry_Priority_Count];
+	unsigned long m_evictedSentences;
+	bool admitSentence(const unsigned char *_buf, unsigned int _len, unsigned char _delimiter);
+	void forgetSentence();
+
+	void addTransmitChar(char _c);
+	void addTransmitTerm(const char *_term, unsigned int _len);
+
+	void addTransmitField(unsigned char _fieldType, const void *_data, unsigned int _dataLen);
+	void addTransmitInteger(unsigned char _fieldType, unsigned long _value, unsigned int _size);
+	void binaryTransmissionEnd();
 
 public:
 
@@ -70,17 +169,70 @@ public:
 	void tick();
 	void parse(const unsigned char *_buf, unsigned int _bufLen);
 
+	// ICommunicationSink
+	void receive(const unsigned char *_buf, unsigned int _bufLen)
+	{
+		parse(_buf, _bufLen);
+	}
+
+	// Select the outgoing wire format. The switch happens once
+	// both transmit lanes are empty; until then urgent sentences
+	// go out in the old format and bulk sentences are held back.
+	void setTransmitFormat(CTelemetry_FormatE _format);
+
+	CTelemetry_FormatE getTransmitFormat()
+	{
+		return m_transmitFormat;
+	}
+
+	// Only send sentences that changed since they were last sent
+	void setDeltaMode(bool _deltaMode)
+	{
+		m_deltaMode = _deltaMode;
+		requestKeyframe();
+	}
+
+	bool getDeltaMode()
+	{
+		return m_deltaMode;
+	}
+
+	// Send every sentence next time, changed or not
+	void requestKeyframe()
+	{
+		m_lastSentValid = 0;
+	}
+
+	// Sentences that didn't fit in the transmit buffer
+	unsigned long getDroppedSentences(CTelemetry_PriorityE _priority)
+	{
+		return m_droppedSentences[_priority];
+	}
+
+	// Waiting bulk sentences pushed out by newer ones
+	unsigned long getEvictedSentences()
+	{
+		return m_evictedSentences;
+	}
+
 	// Interface for sending data
-	void transmissionStart();
+	void transmissionStart(CTelemetry_PriorityE _priority = CTelemetry_Priority_Bulk);
 	void sendTerm(const char *_value);
 
 	void sendTerm(int _value);
 	void sendTerm(unsigned int _value);
+	void sendTerm(long _value);
+	void sendTerm(unsigned long _value);
 
 	void sendTerm(bool _value);
-	void sendTerm(double _value);
+	void sendTerm(double _value, int _decimals = CTelemetry_DEF_DECIMALS);
 
 	void transmissionEnd();
 };
 
+// Shared with other code that builds NMEA style sentences.
+// Telemetry_UtoA() writes no terminator and returns the length.
+extern const char g_telemetryHexChars[];
+unsigned int Telemetry_UtoA(unsigned long _value, char *_str);
+
 #endif
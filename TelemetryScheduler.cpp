@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////
+// Telemetry Scheduler
+////////////////////////////////////////////////////////////
+#include <Arduino.h>
+
+#include "TelemetryTags.h"
+#include "TelemetryScheduler.h"
+
+CTelemetryScheduler::CTelemetryScheduler()
+{
+	for(int tag = 0; tag < CTelemetryScheduler_MAX_TAGS; ++tag)
+	{
+		m_entries[tag].m_periodMS = 0;
+		m_entries[tag].m_nextMS = 0;
+		m_entries[tag].m_priority = 0;
+		m_entries[tag].m_registered = false;
+	}
+
+	m_sendFunction = 0;
+	m_burstSize = GARY_COOPER_DEF_TELEMETRY_BURST;
+}
+
+CTelemetryScheduler::~CTelemetryScheduler()
+{
+}
+
+void CTelemetryScheduler::addTag(int _tag, unsigned long _periodMS, unsigned long _phaseMS, unsigned char _priority)
+{
+	if((_tag < 0) || (_tag >= CTelemetryScheduler_MAX_TAGS))
+		return;
+
+	m_entries[_tag].m_periodMS = _periodMS;
+	m_entries[_tag].m_nextMS = millis() + _phaseMS;
+	m_entries[_tag].m_priority = _priority;
+	m_entries[_tag].m_registered = true;
+}
+
+unsigned long CTelemetryScheduler::getPeriod(int _tag)
+{
+	if((_tag < 0) || (_tag >= CTelemetryScheduler_MAX_TAGS))
+		return 0;
+
+	return m_entries[_tag].m_periodMS;
+}
+
+telemetrycommandResponseE CTelemetryScheduler::setPeriod(int _tag, unsigned long _periodMS)
+{
+	// Only tags this build sends can be changed
+	if((_tag < 0) || (_tag >= CTelemetryScheduler_MAX_TAGS) || !m_entries[_tag].m_registered)
+		return telemetry_cmd_response_nak_invalid_value;
+
+	// Zero turns the tag off
+	if((_periodMS != 0) &&
+			((_periodMS < GARY_COOPER_MIN_TELEMETRY_PERIOD_MS) || (_periodMS > GARY_COOPER_MAX_TELEMETRY_PERIOD_MS)))
+		return telemetry_cmd_response_nak_invalid_value;
+
+	// Send it soon so the house sees the change
+	m_entries[_tag].m_periodMS = _periodMS;
+	m_entries[_tag].m_nextMS = millis();
+
+	return telemetry_cmd_response_ack;
+}
+
+void CTelemetryScheduler::tick()
+{
+	if(!m_sendFunction)
+		return;
+
+	uint32_t now = millis();
+
+	for(int sent = 0; sent < m_burstSize; ++sent)
+	{
+		// Find the most urgent tag that is due. Ties go to
+		// the one that has been waiting longest.
+		int best = -1;
+		for(int tag = 0; tag < CTelemetryScheduler_MAX_TAGS; ++tag)
+		{
+			CTelemetryScheduler_EntryS &entry = m_entries[tag];
+
+			// Off, or not due yet? (Rollover safe)
+			if(!entry.m_periodMS || ((int32_t)(now - entry.m_nextMS) < 0))
+				continue;
+
+			if((best < 0) ||
+					(entry.m_priority < m_entries[best].m_priority) ||
+					((entry.m_priority == m_entries[best].m_priority) &&
+					 ((int32_t)(entry.m_nextMS - m_entries[best].m_nextMS) < 0)))
+				best = tag;
+		}
+
+		// Nothing (more) to do
+		if(best < 0)
+			return;
+
+		// Schedule the next one. If we fell more than a period
+		// behind, don't try to catch up.
+		CTelemetryScheduler_EntryS &entry = m_entries[best];
+		entry.m_nextMS += entry.m_periodMS;
+		if((int32_t)(now - entry.m_nextMS) >= 0)
+			entry.m_nextMS = now + entry.m_periodMS;
+
+		m_sendFunction(best);
+	}
+}
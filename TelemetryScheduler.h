@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////
+// Telemetry Scheduler
+////////////////////////////////////////////////////////////
+#ifndef TelemetryScheduler_h
+#define TelemetryScheduler_h
+
+////////////////////////////////////////////////////////////
+// Sends each telemetry tag at its own rate. Every tag has a
+// period, a phase offset so tags with the same period don't
+// all come due together, and a priority (0 is most urgent).
+// Each tick sends at most the burst size worth of sentences,
+// most urgent first, and leaves the rest for the next tick.
+////////////////////////////////////////////////////////////
+#define CTelemetryScheduler_MAX_TAGS	(16)
+
+// Called to send the sentence for a tag
+typedef void (*CTelemetryScheduler_SendFunction)(int _tag);
+
+class CTelemetryScheduler
+{
+protected:
+	typedef struct
+	{
+		unsigned long m_periodMS;	// Zero if the tag is not sent
+		uint32_t m_nextMS;			// millis() when next due
+		unsigned char m_priority;
+		bool m_registered;			// Set by addTag()
+	} CTelemetryScheduler_EntryS;
+
+	CTelemetryScheduler_EntryS m_entries[CTelemetryScheduler_MAX_TAGS];
+	CTelemetryScheduler_SendFunction m_sendFunction;
+
+	int m_burstSize;
+
+public:
+	CTelemetryScheduler();
+	virtual ~CTelemetryScheduler();
+
+	void setSendFunction(CTelemetryScheduler_SendFunction _sendFunction)
+	{
+		m_sendFunction = _sendFunction;
+	}
+
+	void addTag(int _tag, unsigned long _periodMS, unsigned long _phaseMS, unsigned char _priority);
+
+	unsigned long getPeriod(int _tag);
+	telemetrycommandResponseE setPeriod(int _tag, unsigned long _periodMS);
+
+	int getBurstSize()
+	{
+		return m_burstSize;
+	}
+
+	telemetrycommandResponseE setBurstSize(int _burstSize)
+	{
+		if(_burstSize >= GARY_COOPER_MIN_TELEMETRY_BURST && _burstSize <= GARY_COOPER_MAX_TELEMETRY_BURST)
+		{
+			m_burstSize = _burstSize;
+			return telemetry_cmd_response_ack;
+		}
+
+		return telemetry_cmd_response_nak_invalid_value;
+	}
+
+	void tick();
+};
+
+#endif
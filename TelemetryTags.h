@@ -4,6 +4,7 @@
 // Telemetry and command stuff
 #define TELEMETRY_VERSION_INVALID		(0)
 #define TELEMETRY_VERSION_01			(1)
+#define TELEMETRY_VERSION_02			(2)	// Version 1 commands, binary telemetry frames
 
 // Telemetry tags sent FROM the coop controller
 typedef enum
@@ -28,6 +29,20 @@ typedef enum
 
 	telemetry_tag_light_info,	// Morning on / off times , evening on / off times,, state - 0 = off, 1 = on
 
+	telemetry_tag_link_stats,	// Sentences dropped (bulk, urgent) and evicted for lack of transmit buffer, receive bytes lost, UART receive buffer full count
+
+	telemetry_tag_loop_profile,	// Section, count, min, max, mean (microseconds), histogram bucket counts (GARY_COOPER_LOOP_PROFILER builds only)
+
+	telemetry_tag_duty_cycle,	// Awake per mille, window length, time asleep (milliseconds), times slept (GARY_COOPER_IDLE_SLEEP builds only)
+
+	telemetry_tag_nmea_stats,	// GPS sentences seen since startup (RMC, GGA, GSA, GSV, VTG, GLL, other), bytes not passed to the parser
+
+	telemetry_tag_gps_config,	// Configuration state, baud rate, set for lock, commands sent, commands that failed (GARY_COOPER_GPS_CONFIG builds only)
+
+	telemetry_tag_clock,		// Clock valid, seconds since the last fix, drift (ppm), error at the last fix (ms), resets
+
+	telemetry_tag_sun_cache,	// Times the sun times were reused, times they were figured
+
 	telemetry_tag_command_ack = 50,	// Send to ack a command (value is command tag)
 	telemetry_tag_command_nak = 51,	// Send to nak a command (values are command tag, reason)
 
@@ -75,7 +90,11 @@ typedef enum
 
 	telemetry_command_setStuckDoorDelay,
 
-	telemetry_command_loadDefaults
+	telemetry_command_loadDefaults,
+
+	telemetry_command_setTelemetryPeriod,	// Telemetry tag, period in seconds (0 = off)
+	telemetry_command_setTelemetryBurst,	// Sentences sent per loop pass
+	telemetry_command_setKeyframePeriod,	// Seconds between keyframes (0 = off)
 }
 telemetryCommandE;
 
@@ -117,6 +136,18 @@ typedef enum
 #define GARY_COOPER_LIGHT_MAX_EXTRA	(1.0)		// fraction of hour
 #define GARY_COOPER_LIGHT_DEF_EXTRA	(0.5)		// fraction of hour
 
+// Telemetry scheduler stuff
+#define GARY_COOPER_MIN_TELEMETRY_PERIOD_MS (100L)		// Milliseconds
+#define GARY_COOPER_MAX_TELEMETRY_PERIOD_MS (3600000L)	// Milliseconds (one hour)
+
+#define GARY_COOPER_MIN_TELEMETRY_BURST	(1)		// Sentences per loop pass
+#define GARY_COOPER_DEF_TELEMETRY_BURST	(2)
+#define GARY_COOPER_MAX_TELEMETRY_BURST	(16)
+
+#define GARY_COOPER_MIN_KEYFRAME_PERIOD_MS	(1000L)		// Milliseconds
+#define GARY_COOPER_DEF_KEYFRAME_PERIOD_MS	(30000L)	// Milliseconds
+#define GARY_COOPER_MAX_KEYFRAME_PERIOD_MS	(3600000L)	// Milliseconds (one hour)
+
 // Important info
 #define TELEMETRY_BAUD_RATE		(115200)
 
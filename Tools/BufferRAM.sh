@@ -0,0 +1,84 @@
+#!/bin/sh
+############################################################
+# Buffer RAM report, read from the linked ELF
+#
+# Lists the objects that hold the sketch's serial and
+# telemetry buffers, with the size the linker gave each, and
+# their total. Then prints avr-size's summary so the total
+# can be seen against all of static RAM.
+#
+#   Tools/BufferRAM.sh GaryCooper.ino.elf
+#
+# Only objects in the build are listed, so run it on each
+# build configuration. To run it after every link, give
+# arduino-cli a post-link hook:
+#
+#   arduino-cli compile -b arduino:avr:mega --build-property \
+#     'recipe.hooks.linking.postlink.1.pattern=sh "{build.source.path}/Tools/BufferRAM.sh" "{build.path}/{build.project_name}.elf"'
+#
+# Set NM and SIZE to use other tools (plain nm works on a
+# HostSim build, though the sizes are the host's).
+############################################################
+NM=${NM:-avr-nm}
+SIZE=${SIZE:-avr-size}
+
+if [ $# -ne 1 ] || [ ! -f "$1" ]; then
+	echo "usage: $0 sketch.elf" >&2
+	exit 1
+fi
+
+# Objects holding buffers, and what is in them
+BUFFER_OBJECTS="
+s_telemetryPort	Telemetry port: bulk, urgent and receive buffers, receive queue
+s_GPSPort	GPS port: bulk, urgent and receive buffers, receive queue
+g_telemetry	Telemetry sentence and receive term
+g_inputCapture	Input capture buffer
+g_GPSConfig	GPS configuration line
+Serial	UART 0 FIFOs (Arduino core)
+Serial1	UART 1 FIFOs (Arduino core)
+Serial2	UART 2 FIFOs (Arduino core)
+Serial3	UART 3 FIFOs (Arduino core)
+"
+
+"$NM" -S -C "$1" | awk -v objects="$BUFFER_OBJECTS" '
+BEGIN {
+	n = split(objects, lines, "\n")
+	for (i = 1; i <= n; ++i) {
+		if (split(lines[i], field, "\t") == 2) {
+			order[++count] = field[1]
+			what[field[1]] = field[2]
+		}
+	}
+}
+
+# address size type name; only data and bss. Link time
+# optimization renames file statics to name.lto_priv.N
+NF >= 4 && $3 ~ /^[bBdD]$/ {
+	name = $4
+	sub(/\.lto_priv\.[0-9]+$/, "", name)
+	if ((name in what) && !(name in size))
+		size[name] = hex($2)
+}
+
+# Plain awk has no strtonum()
+function hex(digits,    value, i) {
+	value = 0
+	for (i = 1; i <= length(digits); ++i)
+		value = (value * 16) + index("0123456789abcdef", tolower(substr(digits, i, 1))) - 1
+	return value
+}
+
+END {
+	total = 0
+	for (i = 1; i <= count; ++i) {
+		name = order[i]
+		if (name in size) {
+			printf("%6d  %-16s %s\n", size[name], name, what[name])
+			total += size[name]
+		}
+	}
+	printf("%6d  total buffer RAM\n", total)
+}'
+
+echo
+"$SIZE" "$1"